@@ -40,5 +40,6 @@ find_package_handle_standard_args(OptionParser  "Could NOT find OptionParser. In
 
 mark_as_advanced(OptionParser_INCLUDE_DIR OptionParser_LIBRARY)
 
-set(OptionParser_LIBRARIES ${OptionParser_LIBRARY})
+find_package(Threads)
+set(OptionParser_LIBRARIES ${OptionParser_LIBRARY} ${CMAKE_THREAD_LIBS_INIT})
 set(OptionParser_INCLUDE_DIRS ${OptionParser_INCLUDE_DIR})
@@ -4,6 +4,7 @@
 foreach(LIB ${CMAKE_CXX_IMPLICIT_LINK_LIBRARIES} ${PLATFORM_LIBS})
   set(PRIVATE_LIBS "${PRIVATE_LIBS} -l${LIB}")
 endforeach()
+set(PRIVATE_LIBS "${PRIVATE_LIBS} ${CMAKE_THREAD_LIBS_INIT}")
 # Produce a pkg-config file for linking against the shared lib
 configure_file("${CMAKE_PROJECT_NAME}.pc.in" "${CMAKE_PROJECT_NAME}.pc" @ONLY)
 install(FILES
@@ -16,20 +16,29 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "Options.h"
+#include "OptionsHotReload.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 #ifdef IS_NONBROKEN_SYSTEM
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <errno.h>
 #endif
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <ctime>
+#include <cmath>
+#include <clocale>
 #include <iterator>
 #include <algorithm>
 #include <list>
 #include <system_error>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /// \namespace options
 /// all of the option parser stuff is contained in the namespace options.
@@ -40,6 +49,7 @@ namespace options {
 		// we have only one constructor that needs the reference as parameter
 		const sourceFile sourceFile::gUnsetSource("unset",   sourceFile::gUnsetSource);
 		const sourceFile sourceFile::gCmdLine("commandLine", sourceFile::gUnsetSource);
+		const sourceFile sourceFile::gControlSocket("controlSocket", sourceFile::gUnsetSource);
 
 		optionError::optionError(const base* aOffendingOption, const std::string& aWhat):
 			std::runtime_error(aWhat),
@@ -50,6 +60,80 @@ namespace options {
 		const base& optionError::fGetOption() const {
 			return offendingOption;
 		}
+
+		/// \brief convert a floating point number like operator>> would do, but without a stream
+		/// \details the accepted syntax is checked here, strtod and friends are
+		/// used only for the actual conversion, with the text copied to a local
+		/// buffer as [aBegin,aEnd) is not necessarily null terminated.
+		template <typename T> const char* fConvertFloatingPoint(const char* aBegin, const char* aEnd, T& aValue, T(*aConverter)(const char*, char**)) {
+			auto p = aBegin;
+			if (p != aEnd && (*p == '-' || *p == '+')) {
+				++p;
+			}
+			bool foundDigit = false;
+			for (; p != aEnd && *p >= '0' && *p <= '9'; ++p) {
+				foundDigit = true;
+			}
+			if (p != aEnd && *p == '.') {
+				for (++p; p != aEnd && *p >= '0' && *p <= '9'; ++p) {
+					foundDigit = true;
+				}
+			}
+			if (!foundDigit) {
+				return nullptr;
+			}
+			if (p != aEnd && (*p == 'e' || *p == 'E')) {
+				++p;
+				if (p != aEnd && (*p == '-' || *p == '+')) {
+					++p;
+				}
+				bool foundExponentDigit = false;
+				for (; p != aEnd && *p >= '0' && *p <= '9'; ++p) {
+					foundExponentDigit = true;
+				}
+				if (!foundExponentDigit) {
+					return nullptr;
+				}
+			}
+			auto decimalPoint = localeconv()->decimal_point;
+			if (decimalPoint[0] != '.' || decimalPoint[1] != '\0') { // C library would not understand us
+				charRangeBuf buf(aBegin, p);
+				std::istream stream(&buf);
+				T value;
+				stream >> value;
+				if (stream.fail()) {
+					return nullptr;
+				}
+				aValue = value;
+				return p;
+			}
+			char buffer[128];
+			std::string longBuffer;
+			const char* text = buffer;
+			std::size_t length = p - aBegin;
+			if (length < sizeof(buffer)) {
+				memcpy(buffer, aBegin, length);
+				buffer[length] = '\0';
+			} else {
+				longBuffer.assign(aBegin, p);
+				text = longBuffer.c_str();
+			}
+			auto value = aConverter(text, nullptr);
+			if (std::isinf(value)) { // overflow, makes operator>> fail as well
+				return nullptr;
+			}
+			aValue = value;
+			return p;
+		}
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, float& aValue) {
+			return fConvertFloatingPoint(aBegin, aEnd, aValue, strtof);
+		}
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, double& aValue) {
+			return fConvertFloatingPoint(aBegin, aEnd, aValue, strtod);
+		}
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, long double& aValue) {
+			return fConvertFloatingPoint(aBegin, aEnd, aValue, strtold);
+		}
 	} // end of namespace internal
 
 
@@ -61,50 +145,389 @@ namespace options {
 
 	namespace internal { // for clarity we put these options into the
 		// internal namespace, although they are already hidden by the static
+		/// names and explanations of the standard options
+		static constexpr optionDescriptor gStandardOptions[] = {
+			{'\0', "debugOptions", "give debug output to option parsing"},
+			{'\0', "noCfgFiles", "do not read the default config files, must be FIRST option"},
+			{'\0', "noCfgFileRecursion", "do not read config files recursively, must be set before use"},
+			{'h', "help", "give this help"},
+			{'\0', "writeCfgFile", "write a config file"},
+			{'\0', "readCfgFile", "read a config file"},
+			{'\0', "readCfgFileIfThere", "read a config file if it's there"}
+		};
+		static_assert(optionDescriptor::fAreUnique(gStandardOptions), "names of standard options clash");
 		/// standard option for producing debug output about the options
-		static single<bool> gOptionDebugOptions('\0', "debugOptions", "give debug output to option parsing");
+		static single<bool> gOptionDebugOptions(optionDescriptor::fFind(gStandardOptions, "debugOptions"));
 		/// standard option to suppress parsing of config files
-		static single<bool> gOptionNoCfgFiles('\0', "noCfgFiles", "do not read the default config files, must be FIRST option");
+		static single<bool> gOptionNoCfgFiles(optionDescriptor::fFind(gStandardOptions, "noCfgFiles"));
 
 
 		positional_base::positional_base(int aOrderingNumber,
 		                                 base* aAsBase) {
-			if (aAsBase->fIsContainer()) {
-				for (const auto& it : fGetPositonalArgs()) {
-					if (it.second->fIsContainer()) {
+			aAsBase->lIsPositional = true;
+			aAsBase->lPositionalNumber = aOrderingNumber;
+		};
+
+		std::map<int, base*>& positional_base::fGetPositonalArgs(base* aFirstRegistered) {
+			static thread_local std::map<int, base*> gPositinalArgs;
+			gPositinalArgs.clear();
+			bool containerSeen = false;
+			for (auto option = aFirstRegistered; option != nullptr; option = option->lNextRegistered) {
+				if (!option->lIsPositional) {
+					continue;
+				}
+				if (option->fIsContainer()) {
+					if (containerSeen) {
 						throw std::logic_error("only one container type option allowed");
 					}
+					containerSeen = true;
+				}
+				auto result = gPositinalArgs.emplace(option->lPositionalNumber, option);
+				if (result.second == false) {
+					throw std::logic_error("non-unique numbered positional arg");
+				}
+			}
+			return gPositinalArgs;
+		}
+
+		positionalStream::positionalStream():
+			lContainer(nullptr),
+			lHeldBackStart(0),
+			lHeldBackCount(0),
+			lNextLeading(0) {
+		}
+
+		void positionalStream::fAssign(base* aOption, const char* aArg) {
+			aOption->fSetMeFromStringAndCheckRange(aArg, aArg + strlen(aArg), sourceItem(&sourceFile::gCmdLine, 0));
+		}
+
+		void positionalStream::fSetup(const std::map<int, base*>& aPositionals) {
+			for (const auto& it : aPositionals) {
+				if (lContainer == nullptr && it.second->fIsContainer()) {
+					lContainer = it.second;
+				} else if (lContainer == nullptr) {
+					lLeading.push_back(it.second);
+				} else {
+					lTrailing.push_back(it.second);
 				}
 			}
-			auto result = fGetPositonalArgs().emplace(aOrderingNumber, aAsBase);
-			if (result.second == false) {
-				throw std::logic_error("non-unique numbered positional arg");
+			lHeldBack.resize(lTrailing.size());
+		}
+
+		bool positionalStream::fTake(const char* aArg) {
+			if (lNextLeading < lLeading.size()) {
+				lLeadingArgs.push_back(aArg);
+				lNextLeading++;
+				return true;
 			}
-		};
+			if (lContainer == nullptr) {
+				return false;
+			}
+			if (lHeldBack.empty()) {
+				fAssign(lContainer, aArg);
+				return true;
+			}
+			if (lHeldBackCount < lHeldBack.size()) {
+				lHeldBack[(lHeldBackStart + lHeldBackCount++) % lHeldBack.size()] = aArg;
+				return true;
+			}
+			fAssign(lContainer, lHeldBack[lHeldBackStart]);
+			lHeldBack[lHeldBackStart] = aArg;
+			lHeldBackStart = (lHeldBackStart + 1) % lHeldBack.size();
+			return true;
+		}
+
+		void positionalStream::fFinish() {
+			for (std::size_t i = 0; i < lLeadingArgs.size(); i++) {
+				fAssign(lLeading[i], lLeadingArgs[i]);
+			}
+			auto option = lTrailing.rbegin();
+			while (lHeldBackCount > 0) {
+				lHeldBackCount--;
+				fAssign(*option, lHeldBack[(lHeldBackStart + lHeldBackCount) % lHeldBack.size()]);
+				++option;
+			}
+		}
+
+		/// \details The options are set in the same order as they always were: the options in
+		/// front of the container first, when the container is reached the ones behind it are
+		/// filled from the back, and finally the container gets the remaining arguments in order.
+		void positionalStream::fDistribute(const std::map<int, base*>& aPositionals, std::vector<const char*>& aArgs) {
+			std::vector<base*> options;
+			for (const auto& it : aPositionals) {
+				options.push_back(it.second);
+			}
+			std::size_t next = 0;
+			std::size_t last = aArgs.size();
+			auto option = options.begin();
+			auto optionsEnd = options.end();
+			while (next < last && option != optionsEnd) {
+				auto opt = *option;
+				if (opt->fIsContainer()) { // process first options from the back
+					while (optionsEnd - 1 != option && next < last) {
+						--optionsEnd;
+						fAssign(*optionsEnd, aArgs[--last]);
+					}
+					while (next < last) {
+						fAssign(opt, aArgs[next++]);
+					}
+					break;
+				}
+				fAssign(opt, aArgs[next++]);
+				++option;
+			}
+			aArgs.erase(aArgs.begin() + last, aArgs.end());
+			aArgs.erase(aArgs.begin(), aArgs.begin() + next);
+		}
+
+		static void fSetIdentityFromStatus(fileIdentity& aIdentity, const struct stat& aStatus) {
+			aIdentity.lDevice = aStatus.st_dev;
+			aIdentity.lInode = aStatus.st_ino;
+			aIdentity.lSize = aStatus.st_size;
+			aIdentity.lModificationSeconds = aStatus.st_mtime;
+			#ifdef IS_NONBROKEN_SYSTEM
+			aIdentity.lModificationNanoSeconds = aStatus.st_mtim.tv_nsec;
+			#else
+			aIdentity.lModificationNanoSeconds = 0;
+			#endif
+		}
+
+		fileIdentity::fileIdentity():
+			lDevice(0),
+			lInode(0),
+			lSize(0),
+			lModificationSeconds(0),
+			lModificationNanoSeconds(0) {
+		}
+		bool fileIdentity::fSetFrom(const std::string& aFileName) {
+			struct stat status;
+			if (stat(aFileName.c_str(), &status) != 0) {
+				return false;
+			}
+			fSetIdentityFromStatus(*this, status);
+			return true;
+		}
+
+		fileContent::fileContent():
+			lBegin(nullptr),
+			lSize(0),
+			lMapping(nullptr) {
+		}
+		fileContent::~fileContent() {
+			#ifdef IS_NONBROKEN_SYSTEM
+			if (lMapping != nullptr) {
+				munmap(lMapping, lSize);
+			}
+			#endif
+		}
+
+		/// \details regular files are mapped into memory if aMayMap is true, everything else is read
+		/// into a buffer. As with std::ifstream a read error just ends the contents.
+		int fileContent::fRead(const std::string& aFileName, bool aMayMap) {
+			auto fd = open(aFileName.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return errno;
+			}
+			struct stat status;
+			if (fstat(fd, &status) != 0) {
+				auto error = errno;
+				close(fd);
+				return error;
+			}
+			fSetIdentityFromStatus(lIdentity, status);
+			#ifdef IS_NONBROKEN_SYSTEM
+			if (aMayMap && S_ISREG(status.st_mode) && status.st_size > 0) {
+				auto mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapping != MAP_FAILED) {
+					madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+					close(fd);
+					lMapping = mapping;
+					lBegin = static_cast<const char*>(mapping);
+					lSize = status.st_size;
+					return 0;
+				}
+			}
+			#endif
+			if (S_ISREG(status.st_mode)) {
+				lBuffer.reserve(status.st_size);
+			}
+			char chunk[65536];
+			for (;;) {
+				auto nRead = read(fd, chunk, sizeof(chunk));
+				if (nRead < 0 && errno == EINTR) {
+					continue;
+				} else if (nRead <= 0) {
+					break;
+				}
+				lBuffer.append(chunk, nRead);
+			}
+			close(fd);
+			lBegin = lBuffer.data();
+			lSize = lBuffer.size();
+			return 0;
+		}
+
+		constexpr std::size_t optionIndex::gNotIndexed;
+
+		optionIndex::optionIndex():
+			lIsBuilt(false),
+			lGeneration(0) {
+			std::fill(std::begin(lShortOptions), std::end(lShortOptions), nullptr);
+		}
+
+		/// \brief (re-)build the index from the list of registered options starting at aFirstRegistered
+		/// \details throws std::logic_error if a long or short name is taken by more than one option,
+		/// the names are materialized here so background threads only read them
+		void optionIndex::fBuild(base* aFirstRegistered) {
+			fClear();
+			for (auto option = aFirstRegistered; option != nullptr; option = option->lNextRegistered) {
+				option->lLongName.fMaterialize();
+				option->lExplanation.fMaterialize();
+				lOptions.push_back(option);
+			}
+			std::sort(lOptions.begin(), lOptions.end(), [](const base * aLeft, const base * aRight) {
+				auto result = std::char_traits<char>::compare(aLeft->lLongName.fGetData(), aRight->lLongName.fGetData(),
+				              std::min(aLeft->lLongName.fGetLength(), aRight->lLongName.fGetLength()));
+				return result < 0 || (result == 0 && aLeft->lLongName.fGetLength() < aRight->lLongName.fGetLength());
+			});
+			for (std::size_t i = 0; i < lOptions.size(); i++) {
+				auto option = lOptions[i];
+				if (i > 0 && lOptions[i - 1]->lLongName.fEquals(option->lLongName.fGetData(), option->lLongName.fGetLength())) {
+					fClear();
+					throw std::logic_error(conCat(option->lLongName, " already registered"));
+				}
+				if (option->lShortName != '\0') {
+					auto& shortOption = lShortOptions[static_cast<unsigned char>(option->lShortName)];
+					if (shortOption != nullptr) {
+						fClear();
+						throw std::logic_error(conCat(option->lLongName, ": short name '", option->lShortName, " already registered"));
+					}
+					shortOption = option;
+				}
+			}
+			fBuildSlots();
+			lIsBuilt = true;
+		}
+
+		/// FNV-1a hash of the aLength chars at aName
+		std::uint32_t optionIndex::fHash(const char* aName, std::size_t aLength) {
+			std::uint32_t hash = 2166136261u;
+			for (std::size_t i = 0; i < aLength; i++) {
+				hash = (hash ^ static_cast<unsigned char>(aName[i])) * 16777619u;
+			}
+			return hash;
+		}
+
+		/// fill the hash table, which is kept at most half full so probe sequences stay short, and number the options
+		void optionIndex::fBuildSlots() {
+			std::size_t nSlots = 16;
+			while (nSlots < 2 * lOptions.size()) {
+				nSlots *= 2;
+			}
+			lSlots.assign(nSlots, slot{0, 0});
+			lGeneration++;
+			for (std::size_t i = 0; i < lOptions.size(); i++) {
+				lOptions[i]->lIndexPosition = i;
+				auto hash = lOptions[i]->lHash;
+				auto s = hash & (nSlots - 1);
+				while (lSlots[s].lPosition != 0) {
+					s = (s + 1) & (nSlots - 1);
+				}
+				lSlots[s].lHash = hash;
+				lSlots[s].lPosition = i + 1;
+			}
+		}
+
+		void optionIndex::fRemove(const base* aOption) {
+			auto it = std::find(lOptions.begin(), lOptions.end(), aOption);
+			if (it != lOptions.end()) {
+				(*it)->lIndexPosition = gNotIndexed;
+				lOptions.erase(it);
+				fBuildSlots();
+			}
+			for (auto& shortOption : lShortOptions) {
+				if (shortOption == aOption) {
+					shortOption = nullptr;
+				}
+			}
+		}
+
+		void optionIndex::fClear() {
+			lOptions.clear();
+			lSlots.clear();
+			std::fill(std::begin(lShortOptions), std::end(lShortOptions), nullptr);
+			lIsBuilt = false;
+			lGeneration++;
+		}
+
+		base* optionIndex::fFind(const char* aName, std::size_t aLength) const {
+			if (lSlots.empty()) {
+				return nullptr;
+			}
+			auto hash = fHash(aName, aLength);
+			auto mask = lSlots.size() - 1;
+			for (auto s = hash & mask; lSlots[s].lPosition != 0; s = (s + 1) & mask) {
+				if (lSlots[s].lHash == hash) {
+					auto option = lOptions[lSlots[s].lPosition - 1];
+					if (option->lLongName.fEquals(aName, aLength)) {
+						return option;
+					}
+				}
+			}
+			return nullptr;
+		}
 
 
 	} // end of namespace internal
 
 	parser* parser::gParser = nullptr;
+	thread_local parser* parser::gCurrentContext = nullptr;
 
 	parser::parser(const std::string& aDescription, const std::string& aTrailer, const std::vector<std::string>& aSearchPaths):
+		parser(aDescription, aTrailer, aSearchPaths, false) {
+	}
+/// construct the global parser or, with aIsContext, a parserContext which is not registered as the global one
+	parser::parser(const std::string& aDescription, const std::string& aTrailer, const std::vector<std::string>& aSearchPaths, bool aIsContext):
+		lIsContext(aIsContext),
+		lFirstRegistered(nullptr),
 		lDescription(aDescription),
 		lTrailer(aTrailer),
 		lSearchPaths(aSearchPaths),
-		lParsingIsDone(false) {
-		if (gParser != nullptr) {
-			std::cerr << "there may be only one parser" << std::endl;
-			fComplainAndLeave(false);
+		lCfgWatcher(nullptr),
+		lParsingIsDone(false),
+		lParsingIsRunning(false) {
+		if (! lIsContext) {
+			if (gParser != nullptr) {
+				std::cerr << "there may be only one parser" << std::endl;
+				fComplainAndLeave(false);
+			}
+			gParser = this;
 		}
-		gParser = this;
 		lErrorStream = &std::cerr;
 		lMessageStream = &std::cout;
 		lHelpReturnValue = 0;
 		fSetAssignmentChars();
 		lMinusMinusJustEndsOptions = true;
+		lStreamPositionals = false;
+		lCfgCacheIsLoaded = false;
+		lCfgCacheIsDirty = false;
+		lDeferConversions = false;
+		lMayMapCfgFiles = true;
+		#if defined(IS_NONBROKEN_SYSTEM) && defined(_GNU_SOURCE)
+		if (! lIsContext) {
+			// fParse will tell the real program name, until then we guess it is the usual one
+			fStartPrefetch(program_invocation_short_name);
+		}
+		#endif
 	}
 	parser::~parser() {
-		gParser = nullptr;
+		delete lCfgWatcher;
+		if (lPrefetchThread.joinable()) {
+			lPrefetchThread.join();
+		}
+		if (gParser == this) {
+			gParser = nullptr;
+		}
 	}
 
 	bool parser::fIsParsingDone() const {
@@ -132,17 +555,126 @@ namespace options {
 		lExecutableName = aName;
 	}
 
+	void parser::fSetCfgFilesAreWatched() {
+		if (lParsingIsDone) {
+			throw std::logic_error("config files can only be watched if this is set before parsing");
+		}
+		if (lCfgWatcher == nullptr) {
+			lCfgWatcher = new cfgWatcher(*this);
+		}
+	}
+
 	void parser::fRequire(const base* aOption) {
 		lRequiredOptions.insert(aOption);
+		lConstraints.fInvalidate();
 	}
 	void parser::fRequire(std::vector<const base*> aOptions) {
 		lRequiredOptions.insert(aOptions.cbegin(), aOptions.cend());
+		lConstraints.fInvalidate();
+	}
+	void parser::fRequireExactlyOneOf(std::vector<const base*> aOptions) {
+		lOptionGroups.emplace_back(internal::optionGroup::constraint::kExactlyOne, aOptions);
+		lConstraints.fInvalidate();
+	}
+	void parser::fRequireAtLeastOneOf(std::vector<const base*> aOptions) {
+		lOptionGroups.emplace_back(internal::optionGroup::constraint::kAtLeastOne, aOptions);
+		lConstraints.fInvalidate();
+	}
+	void parser::fAllowAtMostOneOf(std::vector<const base*> aOptions) {
+		lOptionGroups.emplace_back(internal::optionGroup::constraint::kAtMostOne, aOptions);
+		lConstraints.fInvalidate();
+	}
+	void parser::fRequireAllOrNoneOf(std::vector<const base*> aOptions) {
+		lOptionGroups.emplace_back(internal::optionGroup::constraint::kAllOrNone, aOptions);
+		lConstraints.fInvalidate();
 	}
 
 
 
 	parser* parser::fGetInstance() {
-		return gParser;
+		return gCurrentContext != nullptr ? gCurrentContext : gParser;
+	}
+
+	/// get the option index, building it from the registered options if not yet done
+	const internal::optionIndex& parser::fGetOptionIndex() {
+		if (!lOptionIndex.fIsBuilt()) {
+			lOptionIndex.fBuild(base::fGetFirstRegistered(fAsContext()));
+		}
+		return lOptionIndex;
+	}
+
+	namespace internal {
+		/// directory part of aFileName, including the trailing /
+		static std::string fDirectoryOf(const std::string& aFileName) {
+			return aFileName.substr(0, aFileName.find_last_of('/') + 1);
+		}
+		static bool fDirectoryExists(const std::string& aDirectory) {
+			struct stat status;
+			return stat(aDirectory.empty() ? "." : aDirectory.c_str(), &status) == 0;
+		}
+		static bool fIsNoCfgFilesArg(const char* aArg) {
+			return aArg[0] == '-' && aArg[1] == '-' && strcmp(gOptionNoCfgFiles.fGetLongName().c_str(), aArg + 2) == 0;
+		}
+	} // end of namespace internal
+
+/// start reading the config files of the search path for aProgName in the background
+
+/// This is done when the global parser is constructed, so the files are read while the application
+/// finishes its static setup. The file names are made here, in the calling thread, so the prefetch thread
+/// does not look at the environment, which the application may still change. fReadConfigFiles() uses only
+/// prefetched files whose names still match, and fParse() drops them when --noCfgFiles is given.
+	void parser::fStartPrefetch(const char* aProgName) {
+		if (lSearchPaths.empty() || lPrefetchThread.joinable()) {
+			return;
+		}
+		for (auto f : lSearchPaths) {
+			auto tildePosition = f.find_first_of('~');
+			if (tildePosition != std::string::npos) {
+				auto home = getenv("HOME");
+				if (home == nullptr) {
+					break;
+				}
+				f.replace(tildePosition, 1, home);
+			}
+			f += aProgName;
+			lPrefetchedCfgFiles.emplace_back(f);
+		}
+		try {
+			lPrefetchThread = std::thread(&parser::fPrefetchConfigFiles, this);
+		} catch (const std::system_error&) { // no thread, no prefetching
+			lPrefetchedCfgFiles.clear();
+		}
+	}
+/// wait for the prefetch thread and forget what it read
+	void parser::fDropPrefetch() {
+		if (lPrefetchThread.joinable()) {
+			lPrefetchThread.join();
+		}
+		lPrefetchedCfgFiles.clear();
+	}
+
+/// read the config files named in lPrefetchedCfgFiles, runs in lPrefetchThread
+
+/// Only the entries of lPrefetchedCfgFiles are written here, and the parser looks at them only after joining the thread.
+	void parser::fPrefetchConfigFiles() {
+		try {
+			std::map<std::string, bool> directoryExists;
+			for (auto& prefetched : lPrefetchedCfgFiles) {
+				auto directory = internal::fDirectoryOf(prefetched.lName);
+				auto known = directoryExists.find(directory);
+				if (known == directoryExists.end()) {
+					known = directoryExists.emplace(directory, internal::fDirectoryExists(directory)).first;
+				}
+				prefetched.lDirectoryExists = known->second;
+				if (prefetched.lDirectoryExists) {
+					prefetched.lError = prefetched.lContent.fRead(prefetched.lName, false); // a copy, as the file may change until it's used
+				}
+			}
+		} catch (...) { // prefetching is just an optimisation, fReadConfigFiles reads the files itself then
+			for (auto& prefetched : lPrefetchedCfgFiles) {
+				prefetched.lName.clear();
+			}
+		}
 	}
 
 /// read config files if present
@@ -150,14 +682,51 @@ namespace options {
 /// this function iterates over the list of config file search paths,
 /// replacing ~ by the home directory and then appends the program name
 /// to the path, and if a file is found it is then read as config file.
+/// Files that were already read by fPrefetchConfigFiles() for the same name are taken from there.
 	void parser::fReadConfigFiles() {
-		for (auto f : lSearchPaths) {
+		if (lPrefetchThread.joinable()) {
+			lPrefetchThread.join();
+		}
+		std::map<std::string, bool> directoryExists;
+		for (std::size_t i = 0; i < lSearchPaths.size(); i++) {
+			auto f = lSearchPaths[i];
 			auto tildePosition = f.find_first_of('~');
 			if (tildePosition != std::string::npos) {
 				f.replace(tildePosition, 1, getenv("HOME"));
 			}
 			f += lProgName;
-			fReadCfgFile(f, internal::sourceItem(), true);
+			const internal::prefetchedCfgFile* prefetched = nullptr;
+			if (i < lPrefetchedCfgFiles.size() && lPrefetchedCfgFiles[i].lName == f) {
+				prefetched = &(lPrefetchedCfgFiles[i]);
+				if (! prefetched->lDirectoryExists) {
+					continue;
+				}
+			} else {
+				// the directories of the search path are often absent, look each of them up only once;
+				// only for this call, as they may be created later, e.g. before a hot reload
+				auto directory = internal::fDirectoryOf(f);
+				auto known = directoryExists.find(directory);
+				if (known == directoryExists.end()) {
+					known = directoryExists.emplace(directory, internal::fDirectoryExists(directory)).first;
+				}
+				if (! known->second) {
+					continue;
+				}
+			}
+			fReadCfgFile(f, internal::sourceItem(), true, prefetched);
+		}
+		lPrefetchedCfgFiles.clear();
+	}
+
+	/// either pass aArg on to the positional options right away or keep it for later
+	void parser::fHandleUnusedArg(const char* aArg) {
+		if (lStreamPositionals && lPositionalStream.fTake(aArg)) {
+			return;
+		}
+		if (lStreamPositionals && lUnusedArgConsumer) {
+			lUnusedArgConsumer(aArg);
+		} else {
+			lUnusedArgs.push_back(aArg);
 		}
 	}
 
@@ -170,6 +739,18 @@ namespace options {
 			throw std::logic_error("parsing may be done only once");
 		}
 		lParsingIsDone = true; // we set this early, as of now now new options may be created
+		class runningFlag { // also reset when leaving by an exception
+		  protected:
+			bool& lFlag;
+		  public:
+			runningFlag(bool& aFlag): lFlag(aFlag) {
+				lFlag = true;
+			};
+			~runningFlag() {
+				lFlag = false;
+			};
+		} running(lParsingIsRunning);
+		lParseTime = std::chrono::system_clock::now();
 		{
 			#ifdef IS_NONBROKEN_SYSTEM
 			auto buf = strdup(argv[0]);
@@ -179,20 +760,30 @@ namespace options {
 			lProgName = argv[0];
 			#endif
 		}
+		if (argc > 1 && internal::fIsNoCfgFilesArg(argv[1])) {
+			fDropPrefetch();
+		}
+		lOptionIndex.fBuild(base::fGetFirstRegistered(fAsContext())); // and so the option set can be frozen
+		lConstraints.fCompile(lOptionIndex, lRequiredOptions, lOptionGroups);
+		if (lCfgWatcher != nullptr) {
+			lCfgWatcher->fRememberDefaults(argc, argv);
+		}
+		if (lStreamPositionals) {
+			lPositionalStream.fSetup(internal::positional_base::fGetPositonalArgs(base::fGetFirstRegistered(fAsContext())));
+		}
 		bool firstOptionNotSeen = true;
 		try {
 			for (int i = 1; i < argc; i++) {
-				if (firstOptionNotSeen && !(argv[i][0] == '-' && argv[i][1] == '-' && internal::gOptionNoCfgFiles.lLongName.compare(argv[i] + 2) == 0)) {
+				if (firstOptionNotSeen && !internal::fIsNoCfgFilesArg(argv[i])) {
 					fReadConfigFiles();
 				}
 				if (argv[i][0] == '-' && argv[i][1] != '-') {
 					auto length = strlen(argv[i]);
 					for (unsigned int j = 1; j < length; j++) {
-						auto it =  base::fGetShortOptionMap().find(argv[i][j]);
-						if (it == base::fGetShortOptionMap().end()) {
+						auto opt = lOptionIndex.fFindShort(argv[i][j]);
+						if (opt == nullptr) {
 							throw std::runtime_error(internal::conCat("unknown short option '", argv[i][j], "'"));
 						} else {
-							auto opt = it->second;
 							if (opt->lNargs > 0 && strlen(argv[i]) > 2) {
 								throw internal::optionError(opt, internal::conCat("run-together short options '", argv[i], "'may not use parameters"));
 							}
@@ -204,7 +795,7 @@ namespace options {
 					if (length == 2) { // end of options
 						for (i++; i < argc; i++) {
 							if (lMinusMinusJustEndsOptions) {
-								lUnusedOptions.push_back(argv[i]);
+								fHandleUnusedArg(argv[i]);
 							} else {
 								lStuffAfterMinusMinus.push_back(argv[i]);
 							}
@@ -212,29 +803,22 @@ namespace options {
 						break;
 					} else {
 						if (nullptr == strchr(argv[i], lPrimaryAssignment)) {
-							auto it = base::fGetOptionMap().find(argv[i] + 2);
-							if (it == base::fGetOptionMap().end()) {
+							auto opt = lOptionIndex.fFind(argv[i] + 2, length - 2);
+							if (opt == nullptr) {
 								throw std::runtime_error(internal::conCat("unknown long option '", argv[i], "'"));
 							}
-							auto opt = it->second;
 							opt->fHandleOption(argc, argv, &i);
 						} else {
-							auto buf = strdup(argv[i]);
-							auto equalsAt = strchr(buf, lPrimaryAssignment);
-							*equalsAt = '\0';
-							auto it = base::fGetOptionMap().find(buf + 2);
-							if (it == base::fGetOptionMap().end()) {
+							auto equalsAt = strchr(argv[i], lPrimaryAssignment);
+							auto opt = lOptionIndex.fFind(argv[i] + 2, equalsAt - (argv[i] + 2));
+							if (opt == nullptr) {
 								throw std::runtime_error(internal::conCat("unknown long option '", argv[i], "'"));
 							}
-							auto opt = it->second;
-							std::stringstream sbuf(equalsAt + 1);
-							opt->fSetMe(sbuf, internal::sourceItem(&internal::sourceFile::gCmdLine, i));
-							opt->fCheckRange();
-							free(buf);
+							opt->fSetMeFromStringAndCheckRange(equalsAt + 1, argv[i] + length, internal::sourceItem(&internal::sourceFile::gCmdLine, i));
 						}
 					}
 				} else {
-					lUnusedOptions.push_back(argv[i]);
+					fHandleUnusedArg(argv[i]);
 				}
 				firstOptionNotSeen = false;
 			}
@@ -242,46 +826,18 @@ namespace options {
 				fReadConfigFiles();
 			}
 
-			if (!internal::positional_base::fGetPositonalArgs().empty()) {
-				std::list<base*> positionalArgs;
-				for (auto it : internal::positional_base::fGetPositonalArgs()) {
-					positionalArgs.push_back(it.second);
-				}
-				while (!lUnusedOptions.empty()) {
-					auto opt = positionalArgs.front();
-					if (opt->fIsContainer()) { // process first options from the back
-						for (;;) {
-							auto opt2 = positionalArgs.back();
-							if (opt2 == opt) {
-								break;
-							}
-							positionalArgs.pop_back();
-							auto& arg = lUnusedOptions.back();
-							std::stringstream sbuf(arg);
-							opt2->fSetMe(sbuf, internal::sourceItem(&internal::sourceFile::gCmdLine, 0));
-							opt2->fCheckRange();
-							lUnusedOptions.pop_back();
-							if (lUnusedOptions.empty()) {
-								break;
-							}
-						}
-					}
-					if (lUnusedOptions.empty()) {
-						break;
-					}
-					auto& arg = lUnusedOptions.front();
-					std::stringstream sbuf(arg);
-					opt->fSetMe(sbuf, internal::sourceItem(&internal::sourceFile::gCmdLine, 0));
-					opt->fCheckRange();
-					lUnusedOptions.erase(lUnusedOptions.begin());
-					if (! opt->fIsContainer()) {
-						positionalArgs.pop_front();
-						if (positionalArgs.empty()) {
-							break;
-						}
+			if (lStreamPositionals) {
+				lPositionalStream.fFinish();
+			} else {
+				internal::positionalStream::fDistribute(internal::positional_base::fGetPositonalArgs(base::fGetFirstRegistered(fAsContext())), lUnusedArgs);
+				if (lUnusedArgConsumer) {
+					for (auto arg : lUnusedArgs) {
+						lUnusedArgConsumer(arg);
 					}
+					lUnusedArgs.clear();
 				}
 			}
+			fResolveDeferredValues();
 		} catch (const internal::rangeError& e) {
 			fGetErrorStream() << e.what() << " in option '" << e.fGetOption().fGetLongName() << "' value '" << e.fGetBadValue() << "'\n";
 			e.fGetOption().fWriteRange(fGetErrorStream());
@@ -300,8 +856,7 @@ namespace options {
 
 
 		if (internal::gOptionDebugOptions) {
-			for (auto & it : base::fGetOptionMap()) {
-				auto opt = it.second;
+			for (auto opt : lOptionIndex.fGetOptions()) {
 				fGetErrorStream() << "option " << opt->lLongName << " has value '";
 				opt->fWriteValue(fGetErrorStream());
 				fGetErrorStream() << "' ";
@@ -312,50 +867,182 @@ namespace options {
 				}
 				fGetErrorStream() << std::endl;
 			}
-			for (auto & unusedOption : lUnusedOptions) {
-				fGetErrorStream() << "unused option '" << unusedOption << "'" << std::endl;
+			for (auto unusedArg : lUnusedArgs) {
+				fGetErrorStream() << "unused option '" << unusedArg << "'" << std::endl;
 			}
 		}
 		fCheckConsistency();
+		if (lCfgCacheIsDirty) {
+			fWriteCfgCache();
+		}
+		if (lCfgWatcher != nullptr) {
+			lCfgWatcher->fStart(lCfgFileNames);
+		}
+		lUnusedOptions.assign(lUnusedArgs.cbegin(), lUnusedArgs.cend());
 		return lUnusedOptions;
 	}
 
+	void parser::fResolveDeferredValues() {
+		for (auto opt : fGetOptionIndex().fGetOptions()) {
+			opt->fResolveDeferredValue();
+		}
+	}
+
+	namespace internal {
+		void compiledConstraints::fCompile(const optionIndex& aIndex, const std::set<const base*>& aRequired, const std::vector<optionGroup>& aGroups) {
+			const auto& options = aIndex.fGetOptions();
+			auto nOptions = options.size();
+			lRequired = optionSet(nOptions);
+			for (auto opt : aRequired) {
+				lRequired.fInsert(opt);
+			}
+			lNRequired = aRequired.size();
+			auto compileRule = [nOptions](std::vector<rule>& aRules, const base * aOption, const std::vector<const base*>& aOthers) {
+				if (aOthers.empty()) {
+					return;
+				}
+				std::set<const base*> distinct(aOthers.cbegin(), aOthers.cend());
+				aRules.emplace_back(aOption, nOptions);
+				for (auto other : distinct) {
+					aRules.back().lOthers.fInsert(other);
+				}
+				aRules.back().lNOthers = distinct.size();
+			};
+			lRequires.clear();
+			lForbids.clear();
+			for (auto opt : options) {
+				compileRule(lRequires, opt, opt->lRequiredOptions);
+				compileRule(lForbids, opt, opt->lForbiddenOptions);
+			}
+			lGroups.clear();
+			for (const auto& optionGroup : aGroups) {
+				std::set<const base*> distinct(optionGroup.lOptions.cbegin(), optionGroup.lOptions.cend());
+				lGroups.emplace_back(nOptions);
+				for (auto opt : distinct) {
+					lGroups.back().lMembers.fInsert(opt);
+				}
+				lGroups.back().lNMembers = distinct.size();
+			}
+			lIndexGeneration = aIndex.fGetGeneration();
+			lIsCompiled = true;
+		}
+
+		/// write the names of those aOptions which are (or with aInSet false are not) in aSet
+		static void fWriteOptionNames(std::ostream& aStream, const std::vector<const base*>& aOptions, const optionSet& aSet, bool aInSet) {
+			for (auto opt : aOptions) {
+				if (aSet.fContains(opt) == aInSet) {
+					aStream << " " << opt->fGetLongName();
+				}
+			}
+		}
+	} // end of namespace internal
+
+/// check the require/forbid rules and the option groups, reporting all violations before leaving
+
+/// The options that were set are turned into a bitset over the dense option indices, and the
+/// rules, compiled into bitsets when the index was built, are each checked by a few word operations.
+/// The rules are gone through option by option only to report a violation.
 	void parser::fCheckConsistency() {
-		std::set<const base*> optionsThatWereSet;
-		for (auto & it : base::fGetOptionMap()) {
-			auto opt = it.second;
+		const auto& index = fGetOptionIndex();
+		if (!lConstraints.fIsCompiledFor(index)) {
+			lConstraints.fCompile(index, lRequiredOptions, lOptionGroups);
+		}
+		const auto& options = index.fGetOptions();
+		internal::optionSet optionsThatWereSet(options.size());
+		for (auto opt : options) {
 			if (opt->fIsSet()) {
-				optionsThatWereSet.insert(opt);
+				optionsThatWereSet.fInsert(opt);
 			}
 		}
-		if (! lRequiredOptions.empty()) {
-			std::vector<const base*> missing;
-			std::set_difference(lRequiredOptions.cbegin(), lRequiredOptions.cend(),
-			                    optionsThatWereSet.cbegin(), optionsThatWereSet.cend(),
-			                    std::inserter(missing, missing.begin()));
-			if (! missing.empty()) {
-				fGetErrorStream() << "The following options are required but were not given:";
-				for (auto opt : missing) {
+		bool violated = false;
+		if (lConstraints.lRequired.fCountCommon(optionsThatWereSet) != lConstraints.lNRequired) {
+			fGetErrorStream() << "The following options are required but were not given:";
+			for (auto opt : options) {
+				if (lRequiredOptions.count(opt) && ! optionsThatWereSet.fContains(opt)) {
 					fGetErrorStream() << " " << opt->fGetLongName();
 				}
-				fGetErrorStream() << "\n";
-				fComplainAndLeave();
 			}
+			for (auto opt : lRequiredOptions) { // disabled ones
+				if (opt->lIndexPosition == internal::optionIndex::gNotIndexed) {
+					fGetErrorStream() << " " << opt->fGetLongName();
+				}
+			}
+			fGetErrorStream() << "\n";
+			violated = true;
 		}
-		for (auto opt : optionsThatWereSet) {
-			for (auto forbidden : opt->lForbiddenOptions) {
-				if (optionsThatWereSet.count(forbidden) != 0) {
-					fGetErrorStream() << "The option " << opt->fGetLongName() << " forbids the use of " << forbidden->fGetLongName() << " but it is given.\n";
-					fComplainAndLeave();
+		for (const auto& rule : lConstraints.lForbids) {
+			if (optionsThatWereSet.fContains(rule.lOption) && rule.lOthers.fCountCommon(optionsThatWereSet) != 0) {
+				for (auto other : rule.lOption->lForbiddenOptions) {
+					if (optionsThatWereSet.fContains(other)) {
+						fGetErrorStream() << "The option " << rule.lOption->fGetLongName() << " forbids the use of " << other->fGetLongName() << " but it is given.\n";
+					}
 				}
+				violated = true;
 			}
-			for (auto required : opt->lRequiredOptions) {
-				if (optionsThatWereSet.count(required) == 0) {
-					fGetErrorStream() << "The option " << opt->fGetLongName() << " requires the use of " << required->fGetLongName() << " but it is not given.\n";
-					fComplainAndLeave();
+		}
+		for (const auto& rule : lConstraints.lRequires) {
+			if (optionsThatWereSet.fContains(rule.lOption) && rule.lOthers.fCountCommon(optionsThatWereSet) != rule.lNOthers) {
+				std::set<const base*> reported; // the rule may name an option more than once
+				for (auto other : rule.lOption->lRequiredOptions) {
+					if (! optionsThatWereSet.fContains(other) && reported.insert(other).second) {
+						fGetErrorStream() << "The option " << rule.lOption->fGetLongName() << " requires the use of " << other->fGetLongName() << " but it is not given.\n";
+					}
 				}
+				violated = true;
+			}
+		}
+		for (std::size_t i = 0; i < lOptionGroups.size(); i++) {
+			const auto& group = lOptionGroups[i];
+			const auto& compiledGroup = lConstraints.lGroups[i];
+			auto nGiven = compiledGroup.lMembers.fCountCommon(optionsThatWereSet);
+			auto complainNoneGiven = [&](const char* aHowMany) {
+				fGetErrorStream() << aHowMany << " of the following options is required but none was given:";
+				internal::fWriteOptionNames(fGetErrorStream(), group.lOptions, optionsThatWereSet, false);
+				fGetErrorStream() << "\n";
+				violated = true;
+			};
+			auto complainSeveralGiven = [&]() {
+				fGetErrorStream() << "Only one of the following options may be given, but these are:";
+				internal::fWriteOptionNames(fGetErrorStream(), group.lOptions, optionsThatWereSet, true);
+				fGetErrorStream() << "\n";
+				violated = true;
+			};
+			switch (group.lConstraint) {
+				case internal::optionGroup::constraint::kExactlyOne:
+					if (nGiven == 0) {
+						complainNoneGiven("Exactly one");
+					} else if (nGiven > 1) {
+						complainSeveralGiven();
+					}
+					break;
+				case internal::optionGroup::constraint::kAtLeastOne:
+					if (nGiven == 0) {
+						complainNoneGiven("At least one");
+					}
+					break;
+				case internal::optionGroup::constraint::kAtMostOne:
+					if (nGiven > 1) {
+						complainSeveralGiven();
+					}
+					break;
+				case internal::optionGroup::constraint::kAllOrNone:
+					// disabled members are never given, so once any member is given the group is incomplete
+					if (nGiven != 0 && nGiven != compiledGroup.lNMembers) {
+						fGetErrorStream() << "The following options must be given all together or not at all:";
+						for (auto opt : group.lOptions) {
+							fGetErrorStream() << " " << opt->fGetLongName();
+						}
+						fGetErrorStream() << ", but these are missing:";
+						internal::fWriteOptionNames(fGetErrorStream(), group.lOptions, optionsThatWereSet, false);
+						fGetErrorStream() << "\n";
+						violated = true;
+					}
+					break;
 			}
 		}
+		if (violated) {
+			fComplainAndLeave();
+		}
 	}
 
 /// print help (if required) and exit.
@@ -373,52 +1060,218 @@ namespace options {
 		lMinusMinusJustEndsOptions = false;
 	}
 
+	namespace internal {
+		/// \brief split aLine into words like a POSIX shell does, but without any expansions
+		/// \details false if a quote is not closed or aLine ends in a backslash
+		static bool fSplitShellWords(const std::string& aLine, std::vector<std::string>& aWords) {
+			std::string word;
+			bool inWord = false;
+			for (std::size_t i = 0; i < aLine.size(); i++) {
+				auto c = aLine[i];
+				if (c == '\\' && i + 1 < aLine.size() && aLine[i + 1] == '\n') { // line continuation
+					i++;
+				} else if (c == ' ' || c == '\t' || c == '\n') {
+					if (inWord) {
+						aWords.push_back(word);
+						word.clear();
+						inWord = false;
+					}
+				} else if (c == '\\') {
+					if (++i == aLine.size()) {
+						return false;
+					}
+					word.push_back(aLine[i]);
+					inWord = true;
+				} else if (c == '\'') {
+					auto end = aLine.find('\'', i + 1);
+					if (end == std::string::npos) {
+						return false;
+					}
+					word.append(aLine, i + 1, end - i - 1);
+					i = end;
+					inWord = true;
+				} else if (c == '"') {
+					for (i++; i < aLine.size() && aLine[i] != '"'; i++) {
+						c = aLine[i];
+						if (c == '\\' && i + 1 < aLine.size()) {
+							auto next = aLine[i + 1];
+							if (next == '$' || next == '`' || next == '"' || next == '\\' || next == '\n') {
+								i++;
+								if (next != '\n') {
+									word.push_back(next);
+								}
+								continue;
+							}
+						}
+						word.push_back(c);
+					}
+					if (i == aLine.size()) {
+						return false;
+					}
+					inWord = true;
+				} else {
+					word.push_back(c);
+					inWord = true;
+				}
+			}
+			if (inWord) {
+				aWords.push_back(word);
+			}
+			return true;
+		}
+	} // end of namespace internal
+
+	parserContext::parserContext(const std::string& aDescription, const std::string& aTrailer):
+		parserContext(aDescription, aTrailer, {}) {
+	}
+	parserContext::parserContext(const std::string& aDescription, const std::string& aTrailer, const std::vector<std::string>& aSearchPaths):
+		parser(aDescription, aTrailer, aSearchPaths, true),
+		lPreviousContext(gCurrentContext) {
+		gCurrentContext = this;
+		lErrorStream = &lErrorText;
+	}
+	parserContext::~parserContext() {
+		fLeave();
+	}
+	void parserContext::fLeave() {
+		if (gCurrentContext == this) {
+			gCurrentContext = lPreviousContext;
+		}
+	}
+
+	const std::vector<std::string>& parserContext::fParse(int argc, char *argv[]) {
+		return fParse(argc, const_cast<const char**>(argv));
+	}
+
+	const std::vector<std::string>& parserContext::fParse(int argc, const char *argv[]) {
+		auto previousContext = gCurrentContext;
+		gCurrentContext = this; // in case another context was made after this one
+		try {
+			const auto& unusedOptions = parser::fParse(argc, argv);
+			gCurrentContext = previousContext;
+			return unusedOptions;
+		} catch (...) {
+			gCurrentContext = previousContext;
+			throw;
+		}
+	}
+
+	const std::vector<std::string>& parserContext::fParse(const std::vector<std::string>& aArgs) {
+		lArgs = aArgs;
+		std::vector<const char*> argv;
+		argv.reserve(lArgs.size() + 2);
+		for (const auto& arg : lArgs) {
+			argv.push_back(arg.c_str());
+		}
+		if (argv.empty()) { // fParse needs a program name
+			argv.push_back("");
+		}
+		argv.push_back(nullptr);
+		return fParse(static_cast<int>(argv.size() - 1), argv.data());
+	}
+
+	const std::vector<std::string>& parserContext::fParse(const std::string& aCommandLine) {
+		std::vector<std::string> words;
+		if (! internal::fSplitShellWords(aCommandLine, words)) {
+			fGetErrorStream() << "unterminated quote or escape in '" << aCommandLine << "'\n";
+			fComplainAndLeave(false);
+		}
+		return fParse(words);
+	}
+
+/// throw an internal::parseError telling the error messages written since the last one
+	void parserContext::fComplainAndLeave(bool /*aWithHelp*/) {
+		auto text = lErrorText.str();
+		lErrorText.str("");
+		while (!text.empty() && text.back() == '\n') {
+			text.pop_back();
+		}
+		throw internal::parseError(text.empty() ? "parsing failed" : text);
+	}
+
+	namespace internal {
+		/// escape sequences that fPrintEscapedString() writes for each char, nullptr for chars written as they are
+		class escapeTable {
+		  public:
+			const char* lSequences[256];
+			escapeTable() {
+				for (int c = 0; c < 256; c++) {
+					lSequences[c] = (c > ' ' && c < 127) ? nullptr : ""; // empty for octal escapes
+				}
+				lSequences[static_cast<unsigned char>('\a')] = "\\a";
+				lSequences[static_cast<unsigned char>('\b')] = "\\b";
+				lSequences[static_cast<unsigned char>('\f')] = "\\f";
+				lSequences[static_cast<unsigned char>('\n')] = "\\n";
+				lSequences[static_cast<unsigned char>('\r')] = "\\r";
+				lSequences[static_cast<unsigned char>('\t')] = "\\t";
+				lSequences[static_cast<unsigned char>(' ')] = "\\ ";
+				lSequences[static_cast<unsigned char>('\v')] = "\\v";
+				lSequences[static_cast<unsigned char>('\\')] = "\\\\";
+				lSequences[static_cast<unsigned char>('\'')] = "\\\'";
+				lSequences[static_cast<unsigned char>('"')] = "\\\"";
+			};
+			static const escapeTable& fGet() {
+				static const escapeTable gTable;
+				return gTable;
+			};
+		};
+		/// first char in [aBegin,aEnd) that fPrintEscapedString() must escape, aEnd if there is none
+		static const char* fFindCharToEscape(const char* aBegin, const char* aEnd, const escapeTable& aTable) {
+			#ifdef __SSE2__
+			auto spaces = _mm_set1_epi8(' ');
+			auto deletes = _mm_set1_epi8(127);
+			auto backslashes = _mm_set1_epi8('\\');
+			auto quotes = _mm_set1_epi8('\'');
+			auto doubleQuotes = _mm_set1_epi8('"');
+			for (; aEnd - aBegin >= 16; aBegin += 16) {
+				auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBegin));
+				// signed compares, so chars from 128 on are not printable either
+				auto printable = _mm_and_si128(_mm_cmpgt_epi8(chunk, spaces), _mm_cmplt_epi8(chunk, deletes));
+				auto special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, backslashes),
+				                            _mm_cmpeq_epi8(chunk, quotes)),
+				                            _mm_cmpeq_epi8(chunk, doubleQuotes));
+				auto mask = _mm_movemask_epi8(_mm_andnot_si128(special, printable)) ^ 0xffff;
+				if (mask != 0) {
+					return aBegin + __builtin_ctz(mask);
+				}
+			}
+			#endif
+			for (; aBegin < aEnd; ++aBegin) {
+				if (aTable.lSequences[static_cast<unsigned char>(*aBegin)] != nullptr) {
+					break;
+				}
+			}
+			return aBegin;
+		}
+	} // end of namespace internal
+
+/// \details Runs of chars that need no escape are written with a single write(), escapes go
+/// through operator<< as they always did, so a width set on aStream applies to the first char.
 	void parser::fPrintEscapedString(std::ostream & aStream, const std::string& aString) {
 		bool delimit = aString.find_first_of(" \t,") != std::string::npos;
 		if (delimit) {
 			aStream << '\'';
 		}
-		for (auto c : aString) {
-			switch (c) {
-				case '\a':
-					aStream << "\\a";
-					break;
-				case '\b':
-					aStream << "\\b";
-					break;
-				case '\f':
-					aStream << "\\f";
-					break;
-				case '\n':
-					aStream << "\\n";
-					break;
-				case '\r':
-					aStream << "\\r";
-					break;
-				case '\t':
-					aStream << "\\t";
-					break;
-				case ' ':
-					aStream << "\\ ";
-					break;
-				case '\v':
-					aStream << "\\v";
-					break;
-				case '\\':
-					aStream << "\\\\";
+		const auto& table = internal::escapeTable::fGet();
+		auto position = aString.data();
+		auto end = position + aString.size();
+		while (position < end) {
+			auto plainEnd = aStream.width() == 0 ? internal::fFindCharToEscape(position, end, table) : position;
+			if (plainEnd != position) {
+				aStream.write(position, plainEnd - position);
+				position = plainEnd;
+				if (position == end) {
 					break;
-				case '\'':
-					aStream << "\\\'";
-					break;
-				case '"':
-					aStream << "\\\"";
-					break;
-				default:
-					if (c >= ' ' && c < 127) {
-						aStream << c;
-					} else {
-						aStream << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned int>(c) << std::setfill(' ') << std::dec;
-					}
+				}
+			}
+			auto c = *position++;
+			auto sequence = table.lSequences[static_cast<unsigned char>(c)];
+			if (sequence == nullptr) {
+				aStream << c;
+			} else if (*sequence != '\0') {
+				aStream << sequence;
+			} else {
+				aStream << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned int>(c) << std::setfill(' ') << std::dec;
 			}
 		}
 		if (delimit) {
@@ -426,6 +1279,146 @@ namespace options {
 		}
 	}
 
+	namespace internal {
+		/// access to the get area of any std::streambuf, so it can be scanned without copying
+		class getAreaAccess: public std::streambuf {
+		  public:
+			static char* fGetPointer(std::streambuf* aBuf) {
+				return (aBuf->*(&getAreaAccess::gptr))();
+			};
+			static char* fGetEnd(std::streambuf* aBuf) {
+				return (aBuf->*(&getAreaAccess::egptr))();
+			};
+			static void fAdvance(std::streambuf* aBuf, std::ptrdiff_t aCount) {
+				(aBuf->*(&getAreaAccess::gbump))(static_cast<int>(aCount));
+			};
+		};
+		/// first char in [aBegin,aEnd) that is a backslash, a newline or aDelimiter, aEnd if there is none
+		static const char* fFindSpecialChar(const char* aBegin, const char* aEnd, char aDelimiter) {
+			#ifdef __SSE2__
+			auto backslashes = _mm_set1_epi8('\\');
+			auto newlines = _mm_set1_epi8('\n');
+			auto delimiters = _mm_set1_epi8(aDelimiter);
+			for (; aEnd - aBegin >= 16; aBegin += 16) {
+				auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBegin));
+				auto special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, backslashes),
+				                            _mm_cmpeq_epi8(chunk, newlines)),
+				                            _mm_cmpeq_epi8(chunk, delimiters));
+				auto mask = _mm_movemask_epi8(special);
+				if (mask != 0) {
+					return aBegin + __builtin_ctz(mask);
+				}
+			}
+			#endif
+			for (; aBegin < aEnd; ++aBegin) {
+				if (*aBegin == '\\' || *aBegin == '\n' || *aBegin == aDelimiter) {
+					break;
+				}
+			}
+			return aBegin;
+		}
+	} // end of namespace internal
+
+	namespace internal {
+		std::size_t stringArena::spanHash::operator()(const charSpan& aSpan) const {
+			std::size_t hash = 2166136261u;
+			for (std::size_t i = 0; i < aSpan.lLength; i++) {
+				hash = (hash ^ static_cast<unsigned char>(aSpan.lData[i])) * 16777619u;
+			}
+			return hash;
+		}
+
+		const char* stringArena::fIntern(const std::string& aString) {
+			auto known = lStrings.find(charSpan{aString.data(), aString.size()});
+			if (known != lStrings.end()) {
+				return known->lData;
+			}
+			auto size = aString.size() + 1;
+			char* chars;
+			if (size > kBlockSize / 4) { // big strings get a block of their own, so the rest of the current block stays usable
+				lBlocks.emplace_back(new char[size]);
+				chars = lBlocks.back().get();
+			} else {
+				if (size > lFreeSize) {
+					lBlocks.emplace_back(new char[kBlockSize]);
+					lFree = lBlocks.back().get();
+					lFreeSize = kBlockSize;
+				}
+				chars = lFree;
+				lFree += size;
+				lFreeSize -= size;
+			}
+			memcpy(chars, aString.c_str(), size);
+			lStrings.insert(charSpan{chars, aString.size()});
+			return chars;
+		}
+
+		void sourceRuns::fAdd(const sourceItem& aSource) {
+			auto file = lKeepSources ? aSource.fGetFile() : &sourceFile::gUnsetSource;
+			auto lineNumber = file == &sourceFile::gUnsetSource ? 0 : aSource.fGetLineNumber();
+			auto index = lSize++;
+			if (!lRuns.empty() && lRuns.back().lFile == file) {
+				auto& last = lRuns.back();
+				auto count = index - last.lFirstIndex;
+				if (count == 1) {
+					last.lLineStep = lineNumber - last.lFirstLineNumber;
+					return;
+				}
+				if (static_cast<long long>(lineNumber) == last.lFirstLineNumber + static_cast<long long>(count) * last.lLineStep) {
+					return;
+				}
+			}
+			lRuns.push_back(run{index, file, lineNumber, 0});
+		}
+
+		sourceItem sourceRuns::fGet(std::size_t aIndex) const {
+			if (aIndex >= lSize) {
+				return sourceItem();
+			}
+			auto it = std::upper_bound(lRuns.begin(), lRuns.end(), aIndex,
+			[](std::size_t aValue, const run & aRun) {
+				return aValue < aRun.lFirstIndex;
+			});
+			--it;
+			if (it->lFile == &sourceFile::gUnsetSource) {
+				return sourceItem();
+			}
+			return sourceItem(it->lFile, it->lFirstLineNumber + static_cast<int>(aIndex - it->lFirstIndex) * it->lLineStep);
+		}
+
+		void sourceRuns::fSetKeepSources(bool aKeepSources) {
+			if (lKeepSources && !aKeepSources) {
+				std::vector<run>().swap(lRuns);
+				if (lSize > 0) {
+					lRuns.push_back(run{0, &sourceFile::gUnsetSource, 0, 0});
+				}
+			}
+			lKeepSources = aKeepSources;
+		}
+	} // end of namespace internal
+
+	const char* parser::fInternString(const std::string& aString) {
+		auto p = fGetInstance();
+		if (p != nullptr) {
+			return p->lStringArena.fIntern(aString);
+		}
+		static internal::stringArena gArena;
+		static std::mutex gArenaMutex;
+		std::lock_guard<std::mutex> lock(gArenaMutex);
+		return gArena.fIntern(aString);
+	}
+
+/// the sourceFile for aFileName read from aParent, the same one each time the file is read again
+	const internal::sourceFile* parser::fGetSourceFile(const std::string& aFileName, const internal::sourceFile& aParent) {
+		for (const auto& file : lSourceFiles) {
+			if (&(file.fGetParent()) == &aParent && file.fGetName() == aFileName) {
+				return &file;
+			}
+		}
+		lSourceFiles.emplace_back(aFileName, aParent);
+		return &(lSourceFiles.back());
+	}
+
 	void parser::fReCaptureEscapedString(std::string& aDest, const std::string& aSource) {
 		std::stringstream buffer(aSource);
 		buffer >> aDest;
@@ -433,12 +1426,10 @@ namespace options {
 	namespace escapedIO {
 
 		std::istream& operator>> (std::istream &aStream, const char*& aCstring) {
-			auto buffer = new std::string;
-			aStream >> *buffer;
-			if (aStream.fail()) {
-				delete buffer;
-			} else { // leak a string...
-				aCstring = buffer->c_str();
+			std::string buffer;
+			aStream >> buffer;
+			if (! aStream.fail()) {
+				aCstring = parser::fInternString(buffer);
 			}
 			return aStream;
 		}
@@ -450,22 +1441,37 @@ namespace options {
 		}
 		std::istream& operator>>(std::istream& aStream, std::string& aString) {
 			std::istream::sentry s(aStream);
+			bool eofSeen = false;
 			if (s) {
 				aString.clear();
-				auto delimiter = aStream.peek();
+				auto buf = aStream.rdbuf();
+				auto delimiter = buf->sgetc();
 				if (delimiter == '"' || delimiter == '\'') { // string is enclosed in a pair of delimiters
-					aStream.get();
+					buf->sbumpc();
 				} else {
+					eofSeen = delimiter == std::char_traits<char>::eof();
 					delimiter = '\0';
 				}
-				while (! aStream.eof()) {
-					auto c = aStream.peek();
-					if (c == '\n' || aStream.eof()) {
+				while (! eofSeen) {
+					auto begin = internal::getAreaAccess::fGetPointer(buf);
+					auto end = internal::getAreaAccess::fGetEnd(buf);
+					if (begin < end) { // copy the plain chars up to the next special one in one go
+						auto special = internal::fFindSpecialChar(begin, end, static_cast<char>(delimiter));
+						aString.append(begin, special - begin);
+						internal::getAreaAccess::fAdvance(buf, special - begin);
+					}
+					auto c = buf->sgetc();
+					if (c == std::char_traits<char>::eof()) {
+						eofSeen = true;
+						break;
+					}
+					if (c == '\n') {
 						break;
 					}
-					aStream.get();
+					buf->sbumpc();
 					if (c == '\\') {
-						c = aStream.get();
+						c = buf->sbumpc();
+						eofSeen = c == std::char_traits<char>::eof();
 						switch (c) {
 							case 'a':
 								aString.push_back('\a');
@@ -493,7 +1499,8 @@ namespace options {
 									char ch = 0;
 									for (int i = 0; i < 3 && c >= '0' && c <= '7'; i++) {
 										ch = (ch << 3) | ((c - '0') & 0x7);
-										c = aStream.get();
+										c = buf->sbumpc(); // this also takes the char after the octal digits
+										eofSeen = c == std::char_traits<char>::eof();
 									}
 									aString.push_back(ch);
 								} else {
@@ -508,7 +1515,7 @@ namespace options {
 					}
 				}
 			}
-			auto eof = aStream.eof();
+			auto eof = aStream.eof() || eofSeen;
 			aStream.clear();
 			if (eof) {
 				aStream.setstate(std::ios_base::eofbit);
@@ -519,9 +1526,11 @@ namespace options {
 
 /// construct an object of type base
 
-/// The newly created object is inserted into the maps sorted by long name and by short name,
+/// The newly created object is added to the list of registered options, from which
+/// the parser builds its option index sorted by long name and by short name,
 /// (short name only if it is not '\0')
-/// If a clash wopuld occur, i.e. either long or short name is already taken an exception is thrown.
+/// If a clash would occur, i.e. either long or short name is already taken an exception is thrown
+/// when the index is built.
 /// \param [in] aShortName short option without the -, use '\0' to have only a long form
 /// \param [in] aLongName long option without the --, must always be given
 /// \param [in] aExplanation explanation for help output
@@ -530,33 +1539,59 @@ namespace options {
 		lShortName(aShortName),
 		lLongName(aLongName),
 		lExplanation(aExplanation),
-		lNargs(aNargs) {
-
-		{
-			auto p = parser::fGetInstance();
-			if (p != nullptr) {
-				if (p->fIsParsingDone()) {
-					throw std::logic_error(internal::conCat(lLongName, " construction after parsing is done"));
-				}
-			}
-		}
+		lHash(internal::optionIndex::fHash(aLongName.data(), aLongName.size())),
+		lIsPositional(false),
+		lNargs(aNargs),
+		lIndexPosition(internal::optionIndex::gNotIndexed),
+		lConversionIsDeferred(false) {
+		fRegister();
+	}
+/// construct an object of type base from a compile time declaration
 
-		if (fGetOptionMap().emplace(lLongName, this).second == false) {
-			throw std::logic_error(internal::conCat(lLongName, " already registered"));
-		}
-		if (lShortName != '\0') {
-			if (fGetShortOptionMap().emplace(lShortName, this).second == false) {
-				throw std::logic_error(internal::conCat(lLongName, ": short name '", lShortName, " already registered"));
+/// The names are not copied but referred to, see optionDescriptor
+/// \param [in] aDescriptor short and long name and explanation of the option
+/// \param [in] aNargs number of arguments/parameters. May be 0 ot 1.
+	base::base(const optionDescriptor& aDescriptor, short aNargs) :
+		lShortName(aDescriptor.lShortName),
+		lLongName(aDescriptor.lLongName, aDescriptor.lLongNameLength),
+		lExplanation(aDescriptor.lExplanation, aDescriptor.lExplanationLength),
+		lHash(aDescriptor.lHash),
+		lIsPositional(false),
+		lNargs(aNargs),
+		lIndexPosition(internal::optionIndex::gNotIndexed),
+		lConversionIsDeferred(false) {
+		fRegister();
+	}
+	void base::fRegister() {
+		lContext = parser::fGetCurrentContext();
+		auto p = parser::fGetInstance();
+		if (p != nullptr) {
+			if (p->fIsParsingDone()) {
+				throw std::logic_error(internal::conCat(lLongName, " construction after parsing is done"));
 			}
+			p->lOptionIndex.fClear();
 		}
+		lNextRegistered = fGetFirstRegistered(lContext);
+		fGetFirstRegistered(lContext) = this;
 		lPreserveWorthyStuff = nullptr;
 	}
 	base::~base() {
-		fGetOptionMap().clear();
-		fGetShortOptionMap().clear();
+		fGetFirstRegistered(lContext) = nullptr;
+		auto p = lContext != nullptr ? lContext : parser::gParser;
+		if (p != nullptr) {
+			p->lOptionIndex.fClear();
+		}
 		delete lPreserveWorthyStuff;
 	}
 
+	base*& base::fGetFirstRegistered(parser* aContext) {
+		if (aContext != nullptr) {
+			return aContext->lFirstRegistered;
+		}
+		static base* gFirstRegistered = nullptr;
+		return gFirstRegistered;
+	}
+
 	/// remember the source that provided the value, e.g. commandline or a config file
 	void base::fSetSource(const internal::sourceItem& aSource) {
 		lSource = aSource;
@@ -568,15 +1603,58 @@ namespace options {
 			throw internal::optionError(this, internal::conCat(lNargs, " args needed, but only ", argc - *i - 1 , " remain."));
 		}
 		if (lNargs == 0) {
+			lConversionIsDeferred = false;
 			fSetMeNoarg(internal::sourceItem(&internal::sourceFile::gCmdLine, *i));
+			fCheckRange();
 		} else if (lNargs == 1) {
-			std::stringstream sbuf(argv[*i + 1]);
-			fSetMe(sbuf, internal::sourceItem(&internal::sourceFile::gCmdLine, *i));
+			auto arg = argv[*i + 1];
+			fSetMeFromStringAndCheckRange(arg, arg + strlen(arg), internal::sourceItem(&internal::sourceFile::gCmdLine, *i));
 			*i += lNargs;
+		} else {
+			fCheckRange();
+		}
+	}
+
+	void base::fSetMeFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) {
+		if (!fConvertFromString(aBegin, aEnd, aSource)) {
+			internal::charRangeBuf buf(aBegin, aEnd);
+			std::istream stream(&buf);
+			fSetMe(stream, aSource);
 		}
+	}
+
+	void base::fSetMeFromStringAndCheckRange(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) {
+		auto p = parser::fGetInstance();
+		if (p != nullptr && p->lDeferConversions && p->lParsingIsRunning && fIsDeferrable()) { // resolved at the end of fParse
+			lDeferredValue.assign(aBegin, aEnd);
+			lDeferredSource = aSource;
+			lConversionIsDeferred = true;
+			fSetSource(aSource);
+			return;
+		}
+		lConversionIsDeferred = false;
+		fSetMeFromString(aBegin, aEnd, aSource);
 		fCheckRange();
 	}
 
+	/// \details errors are reported with the source of the value, as the config file it came from is closed by now
+	void base::fResolveDeferredValue() {
+		if (!lConversionIsDeferred) {
+			return;
+		}
+		lConversionIsDeferred = false;
+		try {
+			fSetMeFromString(lDeferredValue.data(), lDeferredValue.data() + lDeferredValue.size(), lDeferredSource);
+			fCheckRange();
+		} catch (const std::exception& e) {
+			auto p = parser::fGetInstance();
+			if (p != nullptr && lDeferredSource.fGetFile() != &internal::sourceFile::gCmdLine) {
+				p->fGetErrorStream() << lDeferredSource << ": error: " << e.what() << "\n";
+			}
+			throw;
+		}
+	}
+
 	void base::fWriteCfgLines(std::ostream & aStream, const char *aPrefix) const {
 		aStream << aPrefix << lLongName << "=";
 		auto asOriginalStringKeeper = dynamic_cast<const originalStringKeeper*>(this);
@@ -604,21 +1682,40 @@ namespace options {
 	/// disable option by removing it from the maps
 	void base::fDisable() {
 		fHide(); // needed to hide forbidden options
-		fGetOptionMap().erase(lLongName);
-		fGetShortOptionMap().erase(lShortName);
+		for (auto link = &fGetFirstRegistered(lContext); *link != nullptr; link = &((*link)->lNextRegistered)) {
+			if (*link == this) {
+				*link = lNextRegistered;
+				break;
+			}
+		}
+		auto p = lContext != nullptr ? lContext : parser::gParser;
+		if (p != nullptr) {
+			p->lOptionIndex.fRemove(this);
+		}
 	}
 
 	void base::fRequire(const base* aOtherOption) {
 		lRequiredOptions.push_back(aOtherOption);
+		fInvalidateConstraints();
 	}
 	void base::fRequire(std::vector<const base*> aOtherOptions) {
 		lRequiredOptions.insert(lRequiredOptions.end(), aOtherOptions.cbegin(), aOtherOptions.cend());
+		fInvalidateConstraints();
 	}
 	void base::fForbid(const base* aOtherOption) {
 		lForbiddenOptions.push_back(aOtherOption);
+		fInvalidateConstraints();
 	}
 	void base::fForbid(std::vector<const base*> aOtherOptions) {
 		lForbiddenOptions.insert(lForbiddenOptions.end(), aOtherOptions.cbegin(), aOtherOptions.cend());
+		fInvalidateConstraints();
+	}
+	/// make the parser compile its constraints again before checking them
+	void base::fInvalidateConstraints() {
+		auto p = lContext != nullptr ? lContext : parser::gParser;
+		if (p != nullptr) {
+			p->lConstraints.fInvalidate();
+		}
 	}
 
 	namespace internal {
@@ -637,7 +1734,7 @@ namespace options {
 		class NoCfgFileRecursion: public supressed<bool> {
 		  public:
 			NoCfgFileRecursion():
-				supressed('\0', "noCfgFileRecursion", "do not read config files recursively, must be set before use") {
+				supressed(optionDescriptor::fFind(gStandardOptions, "noCfgFileRecursion")) {
 			};
 		};
 		static NoCfgFileRecursion gNoCfgFileRecursion;
@@ -651,7 +1748,7 @@ namespace options {
 		} else {
 			aMessageStream << "      ";
 		}
-		auto explanation = aOption.lExplanation;
+		auto explanation = aOption.lExplanation.fGetString();
 		bool firstLine = true;
 		do {
 			if (firstLine) {
@@ -724,9 +1821,10 @@ namespace options {
 	void parser::fHelp() {
 		*lMessageStream << lProgName << ": " << lDescription << "\n";
 
-		if (!internal::positional_base::fGetPositonalArgs().empty()) {
+		const auto& positionals = internal::positional_base::fGetPositonalArgs(base::fGetFirstRegistered(fAsContext()));
+		if (!positionals.empty()) {
 			*lMessageStream << "Usage: " << lProgName << " [option]...";
-			for (const auto& it : internal::positional_base::fGetPositonalArgs()) {
+			for (const auto& it : positionals) {
 				*lMessageStream << " [" << it.second->fGetLongName() << "]";
 				if (it.second->fIsContainer()) {
 					*lMessageStream << "...";
@@ -746,13 +1844,12 @@ namespace options {
 			}
 		}
 		#endif
-		for (auto & it : base::fGetOptionMap()) {
-			const auto opt = it.second;
-			maxName = std::max(opt->lLongName.length(), maxName);
-			maxExplain = std::max(opt->lExplanation.length(), maxExplain);
+		const auto& options = fGetOptionIndex().fGetOptions();
+		for (const auto opt : options) {
+			maxName = std::max(opt->lLongName.fGetLength(), maxName);
+			maxExplain = std::max(opt->lExplanation.fGetLength(), maxExplain);
 		}
-		for (auto & it : base::fGetOptionMap()) {
-			const auto opt = it.second;
+		for (const auto opt : options) {
 			if (! opt->fIsHidden()) {
 				fPrintOptionHelp(*lMessageStream, *opt, maxName, maxExplain, lineLenght);
 			}
@@ -769,6 +1866,7 @@ namespace options {
 		*lMessageStream << std::endl;
 	}
 	void parser::fWriteCfgFile(const std::string& aFileName) {
+		fResolveDeferredValues();
 		std::ofstream cfgFile(aFileName, std::ofstream::out | std::ofstream::trunc);
 		if (lExecutableName.empty()) {
 			#ifdef IS_NONBROKEN_SYSTEM
@@ -794,8 +1892,7 @@ namespace options {
 			cfgFile << "# " << lProgName << " --noCfgFileRecursion --readCfgFile " << aFileName << " --writeCfgFile " << aFileName << "\n";
 			cfgFile << "# Assuming " << lProgName << " is in your PATH\n";
 		}
-		for (auto & it : base::fGetOptionMap()) {
-			const auto opt = it.second;
+		for (const auto opt : fGetOptionIndex().fGetOptions()) {
 			if (opt->lPreserveWorthyStuff != nullptr) {
 				for (const auto& line : * (opt->lPreserveWorthyStuff)) {
 					cfgFile << "\n" << line;
@@ -816,93 +1913,257 @@ namespace options {
 		cfgFile.close();
 	}
 
+	namespace internal {
+		/// magic string at the start of config cache files, to be changed with the format
+		static const char gCfgCacheMagic[] = "OptionParserCfgCache1\n";
+
+		void fAppendBinary(std::string& aBuffer, const std::string& aString) {
+			fAppendBinary(aBuffer, static_cast<std::uint32_t>(aString.size()));
+			aBuffer += aString;
+		}
+		bool fExtractBinary(const char*& aPosition, const char* aEnd, std::string& aString) {
+			std::uint32_t length;
+			if (!fExtractBinary(aPosition, aEnd, length) || static_cast<std::size_t>(aEnd - aPosition) < length) {
+				return false;
+			}
+			aString.assign(aPosition, length);
+			aPosition += length;
+			return true;
+		}
+		bool fWriteFileAtomically(const std::string& aFileName, const std::string& aContent) {
+			auto tmpName = conCat(aFileName, ".", getpid());
+			{
+				std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+				file.write(aContent.data(), aContent.size());
+				if (!file.good()) {
+					file.close();
+					unlink(tmpName.c_str());
+					return false;
+				}
+			}
+			if (rename(tmpName.c_str(), aFileName.c_str()) != 0) {
+				unlink(tmpName.c_str());
+				return false;
+			}
+			return true;
+		}
+		/// check that aRecords is a complete sequence of line number, line length and line text records
+		static bool fCfgCacheRecordsAreIntact(const std::string& aRecords) {
+			auto position = aRecords.data();
+			auto end = position + aRecords.size();
+			while (position < end) {
+				int lineNumber;
+				std::uint32_t lineLength;
+				if (!fExtractBinary(position, end, lineNumber)
+				        || !fExtractBinary(position, end, lineLength)
+				        || static_cast<std::size_t>(end - position) < lineLength) {
+					return false;
+				}
+				position += lineLength;
+			}
+			return true;
+		}
+	} // end of namespace internal
+
+/// read the config cache file set with fSetCfgCacheFile, dropping it completely if it is not intact
+	void parser::fLoadCfgCache() {
+		lCfgCacheIsLoaded = true;
+		internal::fileContent cacheFile;
+		if (cacheFile.fRead(lCfgCacheFileName) != 0) {
+			return;
+		}
+		auto position = cacheFile.fBegin();
+		auto end = cacheFile.fEnd();
+		auto magicLength = sizeof(internal::gCfgCacheMagic) - 1;
+		if (static_cast<std::size_t>(end - position) < magicLength || memcmp(position, internal::gCfgCacheMagic, magicLength) != 0) {
+			return;
+		}
+		position += magicLength;
+		while (position < end) {
+			std::string name;
+			if (!internal::fExtractBinary(position, end, name)) {
+				lCfgCache.clear();
+				return;
+			}
+			internal::cfgCacheEntry entry;
+			std::uint64_t recordsLength;
+			if (!internal::fExtractBinary(position, end, entry.lIdentity.lDevice)
+			        || !internal::fExtractBinary(position, end, entry.lIdentity.lInode)
+			        || !internal::fExtractBinary(position, end, entry.lIdentity.lSize)
+			        || !internal::fExtractBinary(position, end, entry.lIdentity.lModificationSeconds)
+			        || !internal::fExtractBinary(position, end, entry.lIdentity.lModificationNanoSeconds)
+			        || !internal::fExtractBinary(position, end, recordsLength)
+			        || static_cast<std::uint64_t>(end - position) < recordsLength) {
+				lCfgCache.clear();
+				return;
+			}
+			entry.lRecords.assign(position, recordsLength);
+			position += recordsLength;
+			if (internal::fCfgCacheRecordsAreIntact(entry.lRecords)) { // a broken entry is dropped, the file is read as text then
+				lCfgCache[name] = std::move(entry);
+			}
+		}
+	}
+
+/// write the config cache, via a temporary file so concurrent readers see either the old or the new one
+	void parser::fWriteCfgCache() {
+		std::string buffer(internal::gCfgCacheMagic);
+		for (const auto& it : lCfgCache) {
+			internal::fAppendBinary(buffer, it.first);
+			internal::fAppendBinary(buffer, it.second.lIdentity.lDevice);
+			internal::fAppendBinary(buffer, it.second.lIdentity.lInode);
+			internal::fAppendBinary(buffer, it.second.lIdentity.lSize);
+			internal::fAppendBinary(buffer, it.second.lIdentity.lModificationSeconds);
+			internal::fAppendBinary(buffer, it.second.lIdentity.lModificationNanoSeconds);
+			internal::fAppendBinary(buffer, static_cast<std::uint64_t>(it.second.lRecords.size()));
+			buffer += it.second.lRecords;
+		}
+		if (!internal::fWriteFileAtomically(lCfgCacheFileName, buffer)) {
+			return;
+		}
+		lCfgCacheIsDirty = false;
+	}
+
 	void parser::fReadCfgFile(const std::string& aFileName, const internal::sourceItem& aSource, bool aMayBeAbsent) {
-		std::ifstream cfgFile(aFileName);
-		if (!cfgFile.good() && !(aMayBeAbsent && errno == ENOENT)) {
-			throw std::system_error(errno, std::system_category(),
-			                        internal::conCat("can't acccess config file '", aFileName , "'."));
+		fReadCfgFile(aFileName, aSource, aMayBeAbsent, nullptr);
+	}
+
+	/// \details aPrefetched, if not nullptr, is the already read file
+	void parser::fReadCfgFile(const std::string& aFileName, const internal::sourceItem& aSource, bool aMayBeAbsent, const internal::prefetchedCfgFile* aPrefetched) {
+		const std::string fileName(aFileName); // aFileName may be the value of a readCfgFile option that a nested file overwrites
+		lCfgFileNames.push_back(fileName);
+		const internal::cfgCacheEntry* cached = nullptr;
+		if (!lCfgCacheFileName.empty()) {
+			if (!lCfgCacheIsLoaded) {
+				fLoadCfgCache();
+			}
+			auto it = lCfgCache.find(fileName);
+			internal::fileIdentity identity;
+			if (it != lCfgCache.end() && identity.fSetFrom(fileName) && identity == it->second.lIdentity) {
+				cached = &(it->second);
+			}
 		}
-		auto sourceF = new internal::sourceFile(aFileName, *(aSource.fGetFile()));
+		internal::fileContent readContent;
+		const internal::fileContent& cfgFile = aPrefetched != nullptr ? aPrefetched->lContent : readContent;
+		if (cached == nullptr) {
+			auto error = aPrefetched != nullptr ? aPrefetched->lError : readContent.fRead(fileName, lMayMapCfgFiles);
+			if (error != 0) {
+				if (aMayBeAbsent && error == ENOENT) {
+					return;
+				}
+				throw std::system_error(error, std::system_category(),
+				                        internal::conCat("can't acccess config file '", fileName , "'."));
+			}
+		}
+		auto sourceF = fGetSourceFile(fileName, *(aSource.fGetFile()));
 		int lineNumber = 0;
 		std::vector<std::string>* preserveWorthyStuff = nullptr;
 		bool hideNextOption = false;
 		bool disableNextOption = false;
-		try {
-			while (cfgFile.good()) {
-				std::string line;
-				std::getline(cfgFile, line);
-				lineNumber++;
-				internal::sourceItem source(sourceF, lineNumber);
-				if (line.length() == 0) {
-					hideNextOption = false;
-					disableNextOption = false;
-					continue;
-				} else if (line[0] == '#') {
-					if (line[1] == '#') {
-						if (preserveWorthyStuff == nullptr) {
-							preserveWorthyStuff = new std::vector<std::string>;
-						}
-						preserveWorthyStuff->push_back(line);
-						if (line == "## hide") {
-							hideNextOption = true;
-						} else if (line == "## disable" && ! internal::gNoCfgFileRecursion) {
-							disableNextOption = true;
-						}
-					} else if (preserveWorthyStuff != nullptr) {
-						auto equalsAt = line.find_first_of('=');
-						if (equalsAt != std::string::npos) {
-							auto optionName = line.substr(2, equalsAt - 2);
-							auto it = base::fGetOptionMap().find(optionName);
-							if (it != base::fGetOptionMap().end()) {
-								auto option = it->second;
-								option->fSetPreserveWorthyStuff(preserveWorthyStuff);
-								preserveWorthyStuff = nullptr;
-								if (hideNextOption) {
-									option->fHide();
-								}
-								if (disableNextOption) {
-									option->fDisable();
-								}
+		auto handleLine = [&](const char * line, std::size_t lineLength) {
+			internal::sourceItem source(sourceF, lineNumber);
+			if (lineLength == 0) {
+				hideNextOption = false;
+				disableNextOption = false;
+				return;
+			} else if (line[0] == '#') {
+				if (lineLength > 1 && line[1] == '#') {
+					if (preserveWorthyStuff == nullptr) {
+						preserveWorthyStuff = new std::vector<std::string>;
+					}
+					preserveWorthyStuff->emplace_back(line, lineLength);
+					if (preserveWorthyStuff->back() == "## hide") {
+						hideNextOption = true;
+					} else if (preserveWorthyStuff->back() == "## disable" && ! internal::gNoCfgFileRecursion) {
+						disableNextOption = true;
+					}
+				} else if (preserveWorthyStuff != nullptr) {
+					auto equalsAt = static_cast<const char*>(memchr(line, '=', lineLength));
+					if (equalsAt != nullptr && equalsAt >= line + 2) {
+						auto option = fGetOptionIndex().fFind(line + 2, equalsAt - (line + 2));
+						if (option != nullptr) {
+							option->fSetPreserveWorthyStuff(preserveWorthyStuff);
+							preserveWorthyStuff = nullptr;
+							if (hideNextOption) {
+								option->fHide();
+							}
+							if (disableNextOption) {
+								option->fDisable();
 							}
 						}
 					}
-					continue;
 				}
-				auto equalsAt = line.find_first_of('=');
-				if (equalsAt == std::string::npos || equalsAt < 1 || equalsAt == line.length()) {
-					std::string buf;
-					fReCaptureEscapedString(buf, line);
-					lUnusedOptions.push_back(buf);
-					continue;
-				}
-				auto optionName = line.substr(0, equalsAt);
-				auto it = base::fGetOptionMap().find(optionName);
-				if (it == base::fGetOptionMap().end()) {
-					throw std::runtime_error(internal::conCat("unknown option '", optionName, "'"));
-				}
-				auto option = it->second;
-				if (hideNextOption) {
-					option->fHide();
-				}
-				if (disableNextOption) {
-					option->fDisable();
+				return;
+			}
+			auto equalsAt = static_cast<const char*>(memchr(line, '=', lineLength));
+			if (equalsAt == nullptr || equalsAt == line) {
+				lStrayCfgLines.emplace_back();
+				fReCaptureEscapedString(lStrayCfgLines.back(), std::string(line, lineLength));
+				fHandleUnusedArg(lStrayCfgLines.back().c_str());
+				return;
+			}
+			auto option = fGetOptionIndex().fFind(line, equalsAt - line);
+			if (option == nullptr) {
+				throw std::runtime_error(internal::conCat("unknown option '", std::string(line, equalsAt), "'"));
+			}
+			if (hideNextOption) {
+				option->fHide();
+			}
+			if (disableNextOption) {
+				option->fDisable();
+			}
+			option->fSetMeFromStringAndCheckRange(equalsAt + 1, line + lineLength, source);
+			if (preserveWorthyStuff != nullptr) {
+				option->fSetPreserveWorthyStuff(preserveWorthyStuff);
+				preserveWorthyStuff = nullptr;
+			}
+		};
+		try {
+			if (cached != nullptr) {
+				auto position = cached->lRecords.data();
+				auto end = position + cached->lRecords.size();
+				std::uint32_t lineLength;
+				while (internal::fExtractBinary(position, end, lineNumber)
+				        && internal::fExtractBinary(position, end, lineLength)
+				        && static_cast<std::size_t>(end - position) >= lineLength) {
+					position += lineLength;
+					handleLine(position - lineLength, lineLength);
 				}
-				{
-					std::stringstream sbuf(line.substr(equalsAt + 1));
-					option->fSetMe(sbuf, source);
-					if (preserveWorthyStuff != nullptr) {
-						option->fSetPreserveWorthyStuff(preserveWorthyStuff);
-						preserveWorthyStuff = nullptr;
+			} else {
+				std::string records;
+				auto nextLine = cfgFile.fBegin();
+				auto fileEnd = cfgFile.fEnd();
+				bool moreLines = true;
+				while (moreLines) {
+					auto line = nextLine;
+					auto lineEnd = line < fileEnd ? static_cast<const char*>(memchr(line, '\n', fileEnd - line)) : nullptr;
+					if (lineEnd == nullptr) {
+						lineEnd = fileEnd;
+						moreLines = false;
+					} else {
+						nextLine = lineEnd + 1;
 					}
-					option->fCheckRange();
+					std::size_t lineLength = lineEnd - line;
+					lineNumber++;
+					if (!lCfgCacheFileName.empty()
+					        && (lineLength < 2 || line[0] != '#' || line[1] == '#' || memchr(line, '=', lineLength) != nullptr)) { // plain comments don't matter
+						internal::fAppendBinary(records, lineNumber);
+						internal::fAppendBinary(records, static_cast<std::uint32_t>(lineLength));
+						records.append(line, lineLength);
+					}
+					handleLine(line, lineLength);
+				}
+				if (!lCfgCacheFileName.empty()) {
+					auto& entry = lCfgCache[fileName];
+					entry.lIdentity = cfgFile.fGetIdentity();
+					entry.lRecords.swap(records);
+					lCfgCacheIsDirty = true;
 				}
 			}
 		} catch (const std::exception& e) {
-			fGetErrorStream() << aFileName << ":" << lineNumber << ": error: " << e.what() << "\n";
+			fGetErrorStream() << fileName << ":" << lineNumber << ": error: " << e.what() << "\n";
 			throw;
 		}
-
-		cfgFile.close();
 	}
 
 
@@ -936,7 +2197,7 @@ namespace options {
 		class OptionHelp : public single<bool> {
 		  public:
 			OptionHelp():
-				single('h', "help", "give this help") {
+				single(optionDescriptor::fFind(gStandardOptions, "help")) {
 			}
 			void fSetMeNoarg(const sourceItem& /*aSource*/) override {
 				parser::fGetInstance()->fHelp();
@@ -955,21 +2216,24 @@ namespace options {
 		class OptionWriteCfgFile : public supressed<std::string> {
 		  public:
 			OptionWriteCfgFile():
-				supressed('\0', "writeCfgFile", "write a config file", "") {
+				supressed(optionDescriptor::fFind(gStandardOptions, "writeCfgFile"), "") {
 			}
 			void fSetMe(std::istream& aStream, const sourceItem&/* aSource */) override {
 				aStream >> *this;
 				parser::fGetInstance()->fWriteCfgFile(*this);
 				exit(parser::fGetInstance()->fGetHelpReturnValue());
 			}
+			bool fIsDeferrable() const override {
+				return false;
+			}
 		};
 		static OptionWriteCfgFile gWriteCfgFile;
 
 /// special derived class used to read in config files
 		template <bool mayBeMissing> class OptionReadCfgFile : public single<std::string> {
 		  public:
-			OptionReadCfgFile(const char *name, const char *description):
-				single('\0', name, description, "") {
+			OptionReadCfgFile(const char *aName):
+				single(optionDescriptor::fFind(gStandardOptions, aName), "") {
 			}
 			void fSetMe(std::istream& aStream, const sourceItem& aSource) override {
 				single<std::string>::fSetMe(aStream, aSource);
@@ -978,12 +2242,20 @@ namespace options {
 				}
 				parser::fGetInstance()->fReadCfgFile(*this, aSource, mayBeMissing);
 			};
+			bool fIsDeferrable() const override {
+				return false;
+			}
 			void fWriteCfgLines(std::ostream& aStream, const char */*aPrefix*/) const override {
 				single<std::string>::fWriteCfgLines(aStream, gNoCfgFileRecursion ? "# " : "");
 			};
+			base* fMakeStagingCopy() const override {
+				auto copy = new OptionReadCfgFile(lLongName.fGetData());
+				static_cast<std::string&>(*copy) = *this;
+				return copy;
+			};
 		};
-		static OptionReadCfgFile<false> gReadCfgFile("readCfgFile", "read a config file");
-		static OptionReadCfgFile<true> gReadCfgFileIfThere("readCfgFileIfThere", "read a config file if it's there");
+		static OptionReadCfgFile<false> gReadCfgFile("readCfgFile");
+		static OptionReadCfgFile<true> gReadCfgFileIfThere("readCfgFileIfThere");
 	} // end of name internal
 
 	void originalStringKeeper::fWriteOriginalString(std::ostream& aStream) const {
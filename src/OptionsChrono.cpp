@@ -1,8 +1,14 @@
 #include "OptionsChrono.h"
 #include <ctime>
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <iostream>
-#include <sys/stat.h>
+#include <cstdlib>
 #include <sys/types.h>
 #include <string.h>
 #include <unistd.h>
@@ -11,176 +17,1043 @@
 namespace options {
 	namespace internal {
 
-		std::chrono::duration<double> parseNumberAndUnit(std::stringstream& aStream, int* aMonths, int* aYears) {
-			class unitDescriptor {
-			  public:
-				enum unitType {
-					kUnspecific = 0,
-					kWithEnlargingPrefix = 1 << 0,
-					kWithDiminishingPrefix = 1 << 1,
-					kWithPrefix = kWithEnlargingPrefix | kWithDiminishingPrefix,
-					kMonth = 1 << 2,
-					kYear = (1 << 3) | kWithEnlargingPrefix ,
-					kSecond = kWithDiminishingPrefix
-				};
-				const char *lUnitName;
-				double lFactor;
-				unitType lType;
-				unitDescriptor(decltype(lUnitName) aUnitName,
-				               decltype(lFactor) aFactor,
-				               decltype(lType) aType):
-					lUnitName(aUnitName), lFactor(aFactor), lType(aType) {
-				};
+		/// one lexed duration unit: its length in seconds and how it may be prefixed
+		class durationUnit {
+		  public:
+			enum unitType {
+				kUnspecific = 0,
+				kWithEnlargingPrefix = 1 << 0,
+				kWithDiminishingPrefix = 1 << 1,
+				kMonth = 1 << 2,
+				kYear = (1 << 3) | kWithEnlargingPrefix,
+				kSecond = kWithDiminishingPrefix
 			};
+			long long lSeconds;
+			unitType lType;
+		};
 
-			static std::vector<unitDescriptor> unitDescriptors({
-				{"year",     31557500, unitDescriptor::kYear},
-				{"yr",       31557500, unitDescriptor::kYear},
-				{"a",        31557500, unitDescriptor::kYear},
-				{"month",     2629800, unitDescriptor::kMonth},
-				{"week", 3600 * 24 * 7, unitDescriptor::kUnspecific},
-				{"day",     3600 * 24, unitDescriptor::kUnspecific},
-				{"hour",         3600, unitDescriptor::kUnspecific},
-				{"minute",         60, unitDescriptor::kUnspecific},
-				{"min",            60, unitDescriptor::kUnspecific},
-				{"second",          1, unitDescriptor::kSecond},
-				{"sec",             1, unitDescriptor::kSecond},
-				{"s",               1, unitDescriptor::kSecond}
-			}
-			                                                  );
-
-			class prefixDescriptor {
-			  public:
-				const char *lName;
-				long long lFactor;
-				std::string::size_type lNameLength;
-				prefixDescriptor(decltype(lName) aName, decltype(lFactor) aFactor) :
-					lName(aName), lFactor(aFactor) {
-					lNameLength = strlen(aName);
-				}
+		static const long long kNanoSecondsPerSecond = 1000000000LL;
+		static const long long kFractionScale = 1000000000000000000LL; ///< fractions are kept in units of 1e-18
+		static const long long kPowersOfTen[] = {
+			1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+			1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+			100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+			1000000000000000000LL
+		};
+
+		static void fThrowDurationError(const char* aWhat, const char* aBegin, const char* aEnd) {
+			std::string message(aWhat);
+			message += " in '";
+			message.append(aBegin, aEnd);
+			message += "'";
+			throw std::runtime_error(message);
+		}
+		/// multiply two non-negative numbers, throw if the result does not fit
+		static long long fCheckedMultiply(long long aLeft, long long aRight, const char* aBegin, const char* aEnd) {
+			if (aRight != 0 && aLeft > std::numeric_limits<long long>::max() / aRight) {
+				fThrowDurationError("Duration overflow", aBegin, aEnd);
+			}
+			return aLeft * aRight;
+		}
+		static long long fCheckedAdd(long long aLeft, long long aRight, const char* aBegin, const char* aEnd) {
+			if ((aRight > 0 && aLeft > std::numeric_limits<long long>::max() - aRight) ||
+			        (aRight < 0 && aLeft < std::numeric_limits<long long>::min() - aRight)) {
+				fThrowDurationError("Duration overflow", aBegin, aEnd);
+			}
+			return aLeft + aRight;
+		}
+
+		/// compare the lower-cased unit against aWord, optionally followed by a plural-s
+		static bool fIsWord(const char* aUnit, std::size_t aLength, const char* aWord, std::size_t aWordLength, bool aPluralAllowed = true) {
+			if (aLength == aWordLength + 1 && aPluralAllowed && aUnit[aWordLength] == 's') {
+				aLength = aWordLength;
+			}
+			return aLength == aWordLength && memcmp(aUnit, aWord, aWordLength) == 0;
+		}
+		/// match an unprefixed unit name, a plural-s is allowed for names longer than two chars
+		static bool fMatchUnitName(const char* aUnit, std::size_t aLength, durationUnit& aDescriptor) {
+			if (aLength == 0) {
+				return false;
+			}
+			switch (aUnit[0]) {
+				case 'a':
+					if (aLength == 1) {
+						aDescriptor = {31557500, durationUnit::kYear};
+						return true;
+					}
+					break;
+				case 'd':
+					if (fIsWord(aUnit, aLength, "day", 3)) {
+						aDescriptor = {3600 * 24, durationUnit::kUnspecific};
+						return true;
+					}
+					break;
+				case 'h':
+					if (fIsWord(aUnit, aLength, "hour", 4)) {
+						aDescriptor = {3600, durationUnit::kUnspecific};
+						return true;
+					}
+					break;
+				case 'm':
+					if (fIsWord(aUnit, aLength, "min", 3) || fIsWord(aUnit, aLength, "minute", 6)) {
+						aDescriptor = {60, durationUnit::kUnspecific};
+						return true;
+					}
+					if (fIsWord(aUnit, aLength, "month", 5)) {
+						aDescriptor = {2629800, durationUnit::kMonth};
+						return true;
+					}
+					break;
+				case 's':
+					if (aLength == 1 || fIsWord(aUnit, aLength, "sec", 3) || fIsWord(aUnit, aLength, "second", 6)) {
+						aDescriptor = {1, durationUnit::kSecond};
+						return true;
+					}
+					break;
+				case 'w':
+					if (fIsWord(aUnit, aLength, "week", 4)) {
+						aDescriptor = {3600 * 24 * 7, durationUnit::kUnspecific};
+						return true;
+					}
+					break;
+				case 'y':
+					if (fIsWord(aUnit, aLength, "yr", 2, false) || fIsWord(aUnit, aLength, "year", 4)) {
+						aDescriptor = {31557500, durationUnit::kYear};
+						return true;
+					}
+					break;
+				default:
+					break;
+			}
+			return false;
+		}
+		/// match a unit with an optional SI prefix, returns the decimal exponent of the prefix in aExponent
+		static void fLexUnit(const char* aUnit, std::size_t aLength, durationUnit& aDescriptor, int& aExponent) {
+			aExponent = 0;
+			if (fMatchUnitName(aUnit, aLength, aDescriptor)) {
+				return;
+			}
+			struct prefix {
+				const char* lName;
+				std::size_t lLength;
+				int lExponent;
+				durationUnit::unitType lRequiredType;
 			};
-			static std::vector<prefixDescriptor> diminishingPrefixDescriptors ({
-				{"milli",      1000},
-				{"m",          1000},
-				{"micro",   1000000},
-				{"u",       1000000},
-				{"nano", 1000000000},
-				{"n",    1000000000}
-			}
-			                                                                  );
-			static std::vector<prefixDescriptor> enlargingPrefixDescriptors ({
-				{"kilo",      1000},
-				{"k",         1000},
-				{"mega",   1000000},
-				{"m",      1000000},
-				{"giga", 1000000000},
-				{"g",    1000000000}
-			}
-			                                                                );
-
-			double number;
-			aStream >> number;
-			if (aStream.eof()) {
-				return std::chrono::duration<double>::zero();
-			}
-			std::string unit;
-			aStream >> unit;
-			std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
-			for (auto& unitDesc : unitDescriptors) {
-				auto location = unit.find(unitDesc.lUnitName);
-				if (location != std::string::npos) {
-					auto unitNameLength = strlen(unitDesc.lUnitName);
-					auto nExtraChars = unit.size() - location - unitNameLength;
-					if (nExtraChars > 0 && // next line is special condition to allow a plural-s
-					        !(nExtraChars == 1 && unitNameLength > 2 && unit.back() == 's')) {
-						parser::fGetInstance()->fGetErrorStream() << "Garbage in '" << unit << "' after the unit '" << unitDesc.lUnitName << "'\n";
-						parser::fGetInstance()->fComplainAndLeave();
-					}
-					if (location != 0) {
-						if (!(unitDesc.lType & unitDescriptor::kWithPrefix)) {
-							parser::fGetInstance()->fGetErrorStream() << "Garbage in '" << unit << "' before the unit '" << unitDesc.lUnitName << "'\n";
-							parser::fGetInstance()->fComplainAndLeave();
+			static const prefix prefixes[] = {
+				{"milli", 5, -3, durationUnit::kWithDiminishingPrefix},
+				{"micro", 5, -6, durationUnit::kWithDiminishingPrefix},
+				{"nano",  4, -9, durationUnit::kWithDiminishingPrefix},
+				{"kilo",  4,  3, durationUnit::kWithEnlargingPrefix},
+				{"mega",  4,  6, durationUnit::kWithEnlargingPrefix},
+				{"giga",  4,  9, durationUnit::kWithEnlargingPrefix},
+				{"m",     1, -3, durationUnit::kWithDiminishingPrefix},
+				{"m",     1,  6, durationUnit::kWithEnlargingPrefix},
+				{"u",     1, -6, durationUnit::kWithDiminishingPrefix},
+				{"n",     1, -9, durationUnit::kWithDiminishingPrefix},
+				{"k",     1,  3, durationUnit::kWithEnlargingPrefix},
+				{"g",     1,  9, durationUnit::kWithEnlargingPrefix}
+			};
+			bool unitFound = false;
+			for (const auto& pre : prefixes) {
+				if (aLength > pre.lLength && aUnit[0] == pre.lName[0] && memcmp(aUnit, pre.lName, pre.lLength) == 0 &&
+				        fMatchUnitName(aUnit + pre.lLength, aLength - pre.lLength, aDescriptor)) {
+					unitFound = true;
+					if (aDescriptor.lType & pre.lRequiredType) {
+						aExponent = pre.lExponent;
+						return;
+					}
+				}
+			}
+			fThrowDurationError(unitFound ? "No valid prefix found" : "Unrecognized time unit", aUnit, aUnit + aLength);
+		}
+
+		/// read the unit following the number at aPos, lower-cased into a small buffer, and lex it
+		static void fReadUnit(const char*& aPos, const char* aEnd, const char* aTermBegin, durationUnit& aDescriptor, int& aExponent) {
+			while (aPos < aEnd && isspace(static_cast<unsigned char>(*aPos))) {
+				++aPos;
+			}
+			auto unitBegin = aPos;
+			while (aPos < aEnd && !isspace(static_cast<unsigned char>(*aPos))) {
+				++aPos;
+			}
+			if (unitBegin == aPos) {
+				fThrowDurationError("Missing time unit", aTermBegin, aEnd);
+			}
+			char unit[16];
+			auto unitLength = static_cast<std::size_t>(aPos - unitBegin);
+			if (unitLength > sizeof(unit)) {
+				fThrowDurationError("Unrecognized time unit", unitBegin, aPos);
+			}
+			for (std::size_t i = 0; i < unitLength; i++) {
+				unit[i] = tolower(static_cast<unsigned char>(unitBegin[i]));
+			}
+			fLexUnit(unit, unitLength, aDescriptor, aExponent);
+		}
+
+		void fParseDuration(const char* aBegin, const char* aEnd, long long& aSeconds, long long& aNanoSeconds, int* aMonths, int* aYears) {
+			aSeconds = 0;
+			aNanoSeconds = 0;
+			auto c = aBegin;
+			while (true) {
+				while (c < aEnd && isspace(static_cast<unsigned char>(*c))) {
+					++c;
+				}
+				if (c == aEnd) {
+					break;
+				}
+				auto termBegin = c;
+
+				// the number, as integer part and a fraction in units of 1e-18
+				bool negative = false;
+				if (*c == '-' || *c == '+') {
+					negative = *c == '-';
+					++c;
+				}
+				long long whole = 0;
+				long long fraction = 0;
+				int fractionDigits = 0;
+				bool digitsSeen = false;
+				for (; c < aEnd && isdigit(static_cast<unsigned char>(*c)); ++c) {
+					whole = fCheckedAdd(fCheckedMultiply(whole, 10, termBegin, aEnd), *c - '0', termBegin, aEnd);
+					digitsSeen = true;
+				}
+				if (c < aEnd && *c == '.') {
+					for (++c; c < aEnd && isdigit(static_cast<unsigned char>(*c)); ++c) {
+						if (fractionDigits < 18) {
+							fraction = fraction * 10 + (*c - '0');
+							++fractionDigits;
 						}
-						bool prefixFound = false;
-						if (unitDesc.lType & unitDescriptor::kWithDiminishingPrefix) {
-							for (auto& prefix : diminishingPrefixDescriptors) {
-								if (unit.compare(0, location, prefix.lName) == 0) {
-									number /= prefix.lFactor;
-									prefixFound = true;
-									break;
-								}
+						digitsSeen = true;
+					}
+				}
+				if (!digitsSeen) {
+					fThrowDurationError("Missing number", termBegin, aEnd);
+				}
+				fraction *= kPowersOfTen[18 - fractionDigits];
+				int exponent = 0;
+				if (c < aEnd && (*c == 'e' || *c == 'E')) {
+					auto e = c + 1;
+					bool negativeExponent = false;
+					if (e < aEnd && (*e == '-' || *e == '+')) {
+						negativeExponent = *e == '-';
+						++e;
+					}
+					if (e < aEnd && isdigit(static_cast<unsigned char>(*e))) {
+						for (; e < aEnd && isdigit(static_cast<unsigned char>(*e)); ++e) {
+							if (exponent < 1000) {
+								exponent = exponent * 10 + (*e - '0');
 							}
 						}
-						if (unitDesc.lType & unitDescriptor::kWithEnlargingPrefix) {
-							for (auto& prefix : enlargingPrefixDescriptors) {
-								if (unit.compare(0, location, prefix.lName) == 0) {
-									number *= prefix.lFactor;
-									prefixFound = true;
-									break;
-								}
+						if (negativeExponent) {
+							exponent = -exponent;
+						}
+						c = e;
+					}
+				}
+
+				durationUnit descriptor;
+				int prefixExponent;
+				fReadUnit(c, aEnd, termBegin, descriptor, prefixExponent);
+				exponent += prefixExponent;
+
+				// shift the decimal point by the exponent, at most 18 digits at a time
+				for (; exponent > 0 && (whole != 0 || fraction != 0); exponent -= std::min(exponent, 18)) {
+					auto digits = std::min(exponent, 18);
+					whole = fCheckedAdd(fCheckedMultiply(whole, kPowersOfTen[digits], termBegin, c), fraction / kPowersOfTen[18 - digits], termBegin, c);
+					fraction = (fraction % kPowersOfTen[18 - digits]) * kPowersOfTen[digits];
+				}
+				for (; exponent < 0 && (whole != 0 || fraction != 0); exponent += std::min(-exponent, 18)) {
+					auto digits = std::min(-exponent, 18);
+					fraction = (whole % kPowersOfTen[digits]) * kPowersOfTen[18 - digits] + fraction / kPowersOfTen[digits];
+					whole /= kPowersOfTen[digits];
+				}
+
+				if ((descriptor.lType == durationUnit::kYear && aYears) ||
+				        (descriptor.lType == durationUnit::kMonth && aMonths)) {
+					if (whole > std::numeric_limits<int>::max()) {
+						fThrowDurationError("Duration overflow", termBegin, c);
+					}
+					*(descriptor.lType == durationUnit::kYear ? aYears : aMonths) = negative ? -whole : whole;
+					continue;
+				}
+
+				// multiply with the unit length, the fraction is split so the products stay in range
+				auto seconds = fCheckedMultiply(whole, descriptor.lSeconds, termBegin, c);
+				auto nanoSeconds = (fraction / kNanoSecondsPerSecond) * descriptor.lSeconds +
+				                   (fraction % kNanoSecondsPerSecond) * descriptor.lSeconds / kNanoSecondsPerSecond;
+				seconds = fCheckedAdd(seconds, nanoSeconds / kNanoSecondsPerSecond, termBegin, c);
+				nanoSeconds %= kNanoSecondsPerSecond;
+				if (negative) {
+					seconds = -seconds;
+					nanoSeconds = -nanoSeconds;
+				}
+				aSeconds = fCheckedAdd(aSeconds, seconds, aBegin, aEnd);
+				aNanoSeconds += nanoSeconds;
+				if (aNanoSeconds >= kNanoSecondsPerSecond || aNanoSeconds <= -kNanoSecondsPerSecond) {
+					aSeconds = fCheckedAdd(aSeconds, aNanoSeconds / kNanoSecondsPerSecond, aBegin, aEnd);
+					aNanoSeconds %= kNanoSecondsPerSecond;
+				}
+			}
+		}
+
+		void fParseDuration(const char* aBegin, const char* aEnd, double& aSeconds, int* aMonths, int* aYears) {
+			aSeconds = 0;
+			auto c = aBegin;
+			while (true) {
+				while (c < aEnd && isspace(static_cast<unsigned char>(*c))) {
+					++c;
+				}
+				if (c == aEnd) {
+					break;
+				}
+				auto termBegin = c;
+
+				// the number in plain decimal notation with optional exponent, converted independent of the locale
+				if (*c == '-' || *c == '+') {
+					++c;
+				}
+				bool digitsSeen = false;
+				for (; c < aEnd && isdigit(static_cast<unsigned char>(*c)); ++c) {
+					digitsSeen = true;
+				}
+				if (c < aEnd && *c == '.') {
+					for (++c; c < aEnd && isdigit(static_cast<unsigned char>(*c)); ++c) {
+						digitsSeen = true;
+					}
+				}
+				if (!digitsSeen) {
+					fThrowDurationError("Missing number", termBegin, aEnd);
+				}
+				if (c < aEnd && (*c == 'e' || *c == 'E')) {
+					auto e = c + 1;
+					if (e < aEnd && (*e == '-' || *e == '+')) {
+						++e;
+					}
+					if (e < aEnd && isdigit(static_cast<unsigned char>(*e))) {
+						while (e < aEnd && isdigit(static_cast<unsigned char>(*e))) {
+							++e;
+						}
+						c = e;
+					}
+				}
+				double number;
+				if (fConvertNumber(termBegin, c, number) == nullptr) {
+					fThrowDurationError("Duration overflow", termBegin, c);
+				}
+
+				durationUnit descriptor;
+				int prefixExponent;
+				fReadUnit(c, aEnd, termBegin, descriptor, prefixExponent);
+				number *= std::pow(10.0, prefixExponent);
+
+				if ((descriptor.lType == durationUnit::kYear && aYears) ||
+				        (descriptor.lType == durationUnit::kMonth && aMonths)) {
+					if (std::abs(number) > std::numeric_limits<int>::max()) {
+						fThrowDurationError("Duration overflow", termBegin, c);
+					}
+					*(descriptor.lType == durationUnit::kYear ? aYears : aMonths) = number;
+					continue;
+				}
+				aSeconds += number * descriptor.lSeconds;
+			}
+		}
+
+		/// days since 1970-01-01 of the given proleptic gregorian date, aMonth is 1..12
+		static long long fDaysFromCivil(long long aYear, unsigned aMonth, unsigned aDay) {
+			aYear -= aMonth <= 2;
+			auto era = (aYear >= 0 ? aYear : aYear - 399) / 400;
+			auto yearOfEra = static_cast<unsigned>(aYear - era * 400);
+			auto dayOfYear = (153 * (aMonth + (aMonth > 2 ? -3 : 9)) + 2) / 5 + aDay - 1;
+			auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+			return era * 146097 + static_cast<long long>(dayOfEra) - 719468;
+		}
+		static void fCivilFromDays(long long aDays, long long& aYear, unsigned& aMonth, unsigned& aDay) {
+			aDays += 719468;
+			auto era = (aDays >= 0 ? aDays : aDays - 146096) / 146097;
+			auto dayOfEra = static_cast<unsigned>(aDays - era * 146097);
+			auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+			auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+			auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+			aDay = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+			aMonth = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+			aYear = static_cast<long long>(yearOfEra) + era * 400 + (aMonth <= 2);
+		}
+		static long long fFloorDiv(long long aNumerator, long long aDenominator) {
+			auto quotient = aNumerator / aDenominator;
+			if ((aNumerator % aDenominator != 0) && ((aNumerator < 0) != (aDenominator < 0))) {
+				--quotient;
+			}
+			return quotient;
+		}
+		/// day of the week with 0 for sunday, 1970-01-01 was a thursday
+		static int fWeekDay(long long aDays) {
+			return aDays + 4 - fFloorDiv(aDays + 4, 7) * 7;
+		}
+		static bool fIsLeapYear(long long aYear) {
+			return (aYear % 4 == 0 && aYear % 100 != 0) || aYear % 400 == 0;
+		}
+		/// seconds since the epoch of a broken down time taken as UTC, out of range fields are normalised like mktime does
+		static long long fSecondsFromBrokenDownTime(const std::tm& aTime) {
+			long long year = aTime.tm_year + 1900LL + fFloorDiv(aTime.tm_mon, 12);
+			auto month = static_cast<unsigned>(aTime.tm_mon - fFloorDiv(aTime.tm_mon, 12) * 12) + 1;
+			auto days = fDaysFromCivil(year, month, 1) + aTime.tm_mday - 1;
+			return days * 86400 + aTime.tm_hour * 3600LL + aTime.tm_min * 60LL + aTime.tm_sec;
+		}
+
+		/// time zone rules as read from a TZif file (RFC 8536) or given as POSIX TZ string.
+		/// Zones are loaded once, cached for the lifetime of the program and never changed,
+		/// so conversions are pure functions of the tables and safe to use from any thread.
+		/// Failed lookups are not cached, they fall back to the C library.
+		class timeZone {
+		  protected:
+			class localTimeType {
+			  public:
+				long lOffset; ///< seconds east of UTC
+				bool lIsDst;
+			};
+			/// one of the two yearly transitions of a POSIX TZ rule
+			class ruleDate {
+			  public:
+				char lKind; ///< 'J' for Julian day without leap days, 'D' for zero based day, 'M' for month.week.day
+				int lDay;
+				int lWeek;
+				int lMonth;
+				long lTime; ///< local time of day of the transition in seconds
+			};
+			std::vector<long long> lTransitions;
+			std::vector<unsigned char> lTransitionTypes;
+			std::vector<localTimeType> lTypes;
+			bool lHasRule;
+			bool lHasDst;
+			localTimeType lStandard;
+			localTimeType lDaylight;
+			ruleDate lStart;
+			ruleDate lEnd;
+			bool lUseSystem; ///< no tables available, fall back to the C library
+
+			timeZone():
+				lHasRule(false),
+				lHasDst(false),
+				lStandard{0, false},
+				lDaylight{0, true},
+				lStart{'M', 0, 2, 3, 7200},
+				lEnd{'M', 0, 1, 11, 7200},
+				lUseSystem(false) {
+			};
+
+			static bool fParseRuleName(const char*& aRule) {
+				auto begin = aRule;
+				if (*aRule == '<') {
+					while (*aRule && *aRule != '>') {
+						++aRule;
+					}
+					if (*aRule != '>') {
+						return false;
+					}
+					++aRule;
+					return aRule - begin > 2;
+				}
+				while (isalpha(static_cast<unsigned char>(*aRule))) {
+					++aRule;
+				}
+				return aRule - begin >= 3;
+			}
+			/// parse [+-]hh[:mm[:ss]] as seconds
+			static bool fParseRuleTime(const char*& aRule, long& aSeconds) {
+				long sign = 1;
+				if (*aRule == '+' || *aRule == '-') {
+					sign = *aRule == '-' ? -1 : 1;
+					++aRule;
+				}
+				if (!isdigit(static_cast<unsigned char>(*aRule))) {
+					return false;
+				}
+				long parts[3] = {0, 0, 0};
+				for (int part = 0; part < 3; part++) {
+					while (isdigit(static_cast<unsigned char>(*aRule))) {
+						parts[part] = parts[part] * 10 + (*aRule - '0');
+						++aRule;
+					}
+					if (part == 2 || *aRule != ':' || !isdigit(static_cast<unsigned char>(aRule[1]))) {
+						break;
+					}
+					++aRule;
+				}
+				aSeconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+				return true;
+			}
+			static bool fParseRuleNumber(const char*& aRule, int& aNumber) {
+				if (!isdigit(static_cast<unsigned char>(*aRule))) {
+					return false;
+				}
+				aNumber = 0;
+				while (isdigit(static_cast<unsigned char>(*aRule))) {
+					aNumber = aNumber * 10 + (*aRule - '0');
+					++aRule;
+				}
+				return true;
+			}
+			static bool fParseRuleDate(const char*& aRule, ruleDate& aDate) {
+				aDate.lTime = 7200;
+				if (*aRule == 'J') {
+					aDate.lKind = 'J';
+					++aRule;
+					if (!fParseRuleNumber(aRule, aDate.lDay)) {
+						return false;
+					}
+				} else if (*aRule == 'M') {
+					aDate.lKind = 'M';
+					++aRule;
+					if (!fParseRuleNumber(aRule, aDate.lMonth) || *aRule++ != '.' ||
+					        !fParseRuleNumber(aRule, aDate.lWeek) || *aRule++ != '.' ||
+					        !fParseRuleNumber(aRule, aDate.lDay) ||
+					        aDate.lMonth < 1 || aDate.lMonth > 12 || aDate.lWeek < 1 || aDate.lWeek > 5 || aDate.lDay > 6) {
+						return false;
+					}
+				} else {
+					aDate.lKind = 'D';
+					if (!fParseRuleNumber(aRule, aDate.lDay)) {
+						return false;
+					}
+				}
+				if (*aRule == '/') {
+					++aRule;
+					return fParseRuleTime(aRule, aDate.lTime);
+				}
+				return true;
+			}
+			/// parse a POSIX TZ string like "CET-1CEST,M3.5.0,M10.5.0/3", note the inverted sign of the offsets
+			bool fParseRule(const char* aRule) {
+				long offset;
+				if (!fParseRuleName(aRule) || !fParseRuleTime(aRule, offset)) {
+					return false;
+				}
+				lStandard = {-offset, false};
+				lHasRule = true;
+				if (*aRule == '\0') {
+					return true;
+				}
+				if (!fParseRuleName(aRule)) {
+					return false;
+				}
+				lHasDst = true;
+				lDaylight = {lStandard.lOffset + 3600, true};
+				if (*aRule != ',' && *aRule != '\0') {
+					if (!fParseRuleTime(aRule, offset)) {
+						return false;
+					}
+					lDaylight.lOffset = -offset;
+				}
+				if (*aRule == ',') {
+					++aRule;
+					if (!fParseRuleDate(aRule, lStart) || *aRule++ != ',' || !fParseRuleDate(aRule, lEnd)) {
+						return false;
+					}
+				}
+				return *aRule == '\0';
+			}
+			/// UTC seconds of a rule transition in aYear, aOffset is the offset in effect before it
+			static long long fRuleTransition(long long aYear, const ruleDate& aDate, long aOffset) {
+				auto yearStart = fDaysFromCivil(aYear, 1, 1);
+				long long day;
+				if (aDate.lKind == 'J') {
+					day = yearStart + aDate.lDay - 1 + (fIsLeapYear(aYear) && aDate.lDay >= 60 ? 1 : 0);
+				} else if (aDate.lKind == 'D') {
+					day = yearStart + aDate.lDay;
+				} else {
+					auto monthStart = fDaysFromCivil(aYear, aDate.lMonth, 1);
+					auto monthStartWeekDay = fWeekDay(monthStart);
+					day = monthStart + (aDate.lDay - monthStartWeekDay + 7) % 7 + (aDate.lWeek - 1) * 7;
+					auto nextMonthStart = aDate.lMonth == 12 ? fDaysFromCivil(aYear + 1, 1, 1) : fDaysFromCivil(aYear, aDate.lMonth + 1, 1);
+					while (day >= nextMonthStart) {
+						day -= 7;
+					}
+				}
+				return day * 86400 + aDate.lTime - aOffset;
+			}
+			const localTimeType& fGetRuleType(long long aTime) const {
+				if (!lHasDst) {
+					return lStandard;
+				}
+				long long year;
+				unsigned month, day;
+				fCivilFromDays(fFloorDiv(aTime + lStandard.lOffset, 86400), year, month, day);
+				auto start = fRuleTransition(year, lStart, lStandard.lOffset);
+				auto end = fRuleTransition(year, lEnd, lDaylight.lOffset);
+				bool isDst = start < end ? (start <= aTime && aTime < end) : !(end <= aTime && aTime < start);
+				return isDst ? lDaylight : lStandard;
+			}
+			const localTimeType& fGetType(long long aTime) const {
+				if (lTransitions.empty() || aTime >= lTransitions.back()) {
+					if (lHasRule) {
+						return fGetRuleType(aTime);
+					}
+					if (lTransitions.empty()) {
+						return lTypes.empty() ? lStandard : lTypes.front();
+					}
+				}
+				if (aTime < lTransitions.front()) {
+					return lTypes.front();
+				}
+				auto next = std::upper_bound(lTransitions.begin(), lTransitions.end(), aTime);
+				return lTypes[lTransitionTypes[next - lTransitions.begin() - 1]];
+			}
+
+			static long long fReadBigEndian(const unsigned char* aData, int aBytes) {
+				unsigned long long value = 0;
+				for (int i = 0; i < aBytes; i++) {
+					value = (value << 8) | aData[i];
+				}
+				if (aBytes < 8 && (value & (1ULL << (aBytes * 8 - 1)))) {
+					value |= ~0ULL << (aBytes * 8);
+				}
+				return static_cast<long long>(value);
+			}
+			/// read the tables of a TZif file, the 64 bit data block is preferred when present
+			bool fRead(const std::string& aFileName) {
+				fileContent content;
+				if (content.fRead(aFileName, false) != 0) {
+					return false;
+				}
+				auto data = reinterpret_cast<const unsigned char*>(content.fBegin());
+				auto end = reinterpret_cast<const unsigned char*>(content.fEnd());
+				if (end - data < 44 || memcmp(data, "TZif", 4) != 0) {
+					return false;
+				}
+				int timeSize = 4;
+				if (data[4] >= '2') { // skip the 32 bit block
+					auto counts = data + 20;
+					auto skip = 44 + fReadBigEndian(counts + 12, 4) * 5 + fReadBigEndian(counts + 16, 4) * 6 +
+					            fReadBigEndian(counts + 20, 4) + fReadBigEndian(counts + 8, 4) * 8 +
+					            fReadBigEndian(counts + 4, 4) + fReadBigEndian(counts, 4);
+					if (skip < 0 || end - data < skip + 44 || memcmp(data + skip, "TZif", 4) != 0) {
+						return false;
+					}
+					data += skip;
+					timeSize = 8;
+				}
+				auto counts = data + 20;
+				auto isUtCount = fReadBigEndian(counts, 4);
+				auto isStdCount = fReadBigEndian(counts + 4, 4);
+				auto leapCount = fReadBigEndian(counts + 8, 4);
+				auto timeCount = fReadBigEndian(counts + 12, 4);
+				auto typeCount = fReadBigEndian(counts + 16, 4);
+				auto charCount = fReadBigEndian(counts + 20, 4);
+				auto blockSize = timeCount * (timeSize + 1) + typeCount * 6 + charCount + leapCount * (timeSize + 4) + isStdCount + isUtCount;
+				if (typeCount < 1 || timeCount < 0 || blockSize < 0 || end - data < 44 + blockSize) {
+					return false;
+				}
+				auto item = data + 44;
+				lTransitions.reserve(timeCount);
+				for (long long i = 0; i < timeCount; i++, item += timeSize) {
+					lTransitions.push_back(fReadBigEndian(item, timeSize));
+				}
+				lTransitionTypes.assign(item, item + timeCount);
+				item += timeCount;
+				for (long long i = 0; i < typeCount; i++, item += 6) {
+					lTypes.push_back({static_cast<long>(fReadBigEndian(item, 4)), item[4] != 0});
+				}
+				for (auto type : lTransitionTypes) {
+					if (type >= typeCount) {
+						return false;
+					}
+				}
+				if (timeSize == 8) { // the footer holds the rule for times after the last transition
+					auto footer = data + 44 + blockSize;
+					if (footer < end && *footer == '\n') {
+						auto footerEnd = std::find(footer + 1, end, '\n');
+						if (footerEnd != end && footerEnd > footer + 1) {
+							std::string rule(footer + 1, footerEnd);
+							if (!fParseRule(rule.c_str())) {
+								lHasRule = false;
+								lHasDst = false;
 							}
 						}
-						if (!prefixFound) {
-							parser::fGetInstance()->fGetErrorStream() << "No valid prefix found in '" << unit << "'\n";
-							parser::fGetInstance()->fComplainAndLeave();
+					}
+				}
+				return true;
+			}
+
+			/// the zone read from aFileName, else from aRule if given; only lookups without aRule may fail, these are not cached
+			static const timeZone& fGetCached(const std::string& aKey, const std::string& aFileName, const char* aRule) {
+				static std::mutex mutex;
+				static std::map<std::string, std::unique_ptr<timeZone>> zones;
+				std::lock_guard<std::mutex> lock(mutex);
+				auto& zone = zones[aKey];
+				if (!zone) {
+					std::unique_ptr<timeZone> newZone(new timeZone);
+					if (!newZone->fRead(aFileName)) {
+						*newZone = timeZone();
+						if (aRule == nullptr) {
+							newZone->lUseSystem = true;
+						} else if (!newZone->fParseRule(aRule)) {
+							// like glibc, a local zone that makes no sense is UTC, decided once and cached
+							*newZone = timeZone();
+							newZone->fParseRule("UTC0");
 						}
 					}
-					if ((unitDesc.lType == unitDescriptor::kYear && aYears) ||
-					        (unitDesc.lType == unitDescriptor::kMonth && aMonths)) {
-						if (unitDesc.lType == unitDescriptor::kYear) {
-							*aYears = number;
-						} else {
-							*aMonths = number;
+					if (newZone->lUseSystem) {
+						// don't cache a failed lookup of a zone name, the file may appear later
+						zones.erase(aKey);
+						static std::unique_ptr<timeZone> systemZone;
+						if (!systemZone) {
+							systemZone.reset(new timeZone);
+							systemZone->lUseSystem = true;
 						}
-						return  std::chrono::duration<double>::zero();
-					} else {
-						return std::chrono::duration<double>(unitDesc.lFactor * number);
+						return *systemZone;
 					}
+					zone = std::move(newZone);
 				}
+				return *zone;
 			}
-			parser::fGetInstance()->fGetErrorStream() << "Unrecognized time unit in '" << unit << "'\n";
-			parser::fGetInstance()->fComplainAndLeave();
-			return std::chrono::duration<double>::zero();
-		}
 
-		bool fParseStreamToBrokenDownTime(std::istream &aStream, std::tm* aBrokenDownTime, double& aFractional, std::string& timezone) {
-			aStream >> aBrokenDownTime->tm_year;
-			if (aStream.fail() || aStream.get() != '/') {
-				return false;
+		  public:
+			/// the zone named like the files in TZFILE_PATH, e.g. "Europe/Berlin", throws if there is no such file
+			static const timeZone& fGet(const std::string& aName) {
+				#ifdef TZFILE_PATH
+				std::string fileName(TZFILE_PATH);
+				fileName += aName;
+				auto& zone = fGetCached(fileName, fileName, nullptr);
+				if (!zone.lUseSystem) {
+					return zone;
+				}
+				throw std::runtime_error("can't find timezone file '" + fileName + "'");
+				#else
+				(void)aName;
+				return fGetLocal();
+				#endif
+			}
+			/// the local zone as set by the TZ environment variable or /etc/localtime, UTC if neither makes sense
+			static const timeZone& fGetLocal() {
+				auto tz = getenv("TZ");
+				if (tz == nullptr) {
+					return fGetCached("", "/etc/localtime", "UTC0");
+				}
+				std::string name(tz[0] == ':' ? tz + 1 : tz);
+				std::string fileName(name);
+				#ifdef TZFILE_PATH
+				if (!name.empty() && name[0] != '/') {
+					fileName = TZFILE_PATH + name;
+				}
+				#endif
+				return fGetCached(std::string("TZ=") + tz, fileName, name.empty() ? "UTC0" : name.c_str());
+			}
+
+			/// convert to local broken down time like localtime_r
+			void fToBrokenDownTime(std::time_t aTime, std::tm& aBrokenDownTime) const {
+				if (lUseSystem) {
+					static std::mutex mutex;
+					std::lock_guard<std::mutex> lock(mutex);
+					aBrokenDownTime = *std::localtime(&aTime);
+					return;
+				}
+				auto& type = fGetType(aTime);
+				auto localTime = static_cast<long long>(aTime) + type.lOffset;
+				auto days = fFloorDiv(localTime, 86400);
+				auto secondOfDay = localTime - days * 86400;
+				long long year;
+				unsigned month, day;
+				fCivilFromDays(days, year, month, day);
+				aBrokenDownTime.tm_year = year - 1900;
+				aBrokenDownTime.tm_mon = month - 1;
+				aBrokenDownTime.tm_mday = day;
+				aBrokenDownTime.tm_hour = secondOfDay / 3600;
+				aBrokenDownTime.tm_min = secondOfDay / 60 % 60;
+				aBrokenDownTime.tm_sec = secondOfDay % 60;
+				aBrokenDownTime.tm_wday = fWeekDay(days);
+				aBrokenDownTime.tm_yday = days - fDaysFromCivil(year, 1, 1);
+				aBrokenDownTime.tm_isdst = type.lIsDst;
+			}
+			/// convert local broken down time to UTC like mktime with tm_isdst = -1 and normalise aBrokenDownTime.
+			/// Ambiguous and skipped times are resolved like glibc's mktime does in a fresh process: it starts
+			/// with the offset in effect at the local time read as UTC and follows the offsets found from there.
+			/// So in a fold zones east of UTC get the later, standard time instant, zones west of it the earlier one,
+			/// and in a gap the instant that is in daylight saving time is taken.
+			std::time_t fFromBrokenDownTime(std::tm& aBrokenDownTime) const {
+				if (lUseSystem) {
+					static std::mutex mutex;
+					std::lock_guard<std::mutex> lock(mutex);
+					aBrokenDownTime.tm_isdst = -1;
+					return std::mktime(&aBrokenDownTime);
+				}
+				auto localTime = fSecondsFromBrokenDownTime(aBrokenDownTime);
+				auto time = localTime;
+				auto next = localTime - fGetType(time).lOffset;
+				for (int i = 0; i < 4 && next != time; i++) {
+					time = next;
+					next = localTime - fGetType(time).lOffset;
+				}
+				if (next != time && fGetType(next).lIsDst && !fGetType(time).lIsDst) { // oscillating in a gap
+					time = next;
+				}
+				fToBrokenDownTime(time, aBrokenDownTime);
+				return time;
+			}
+		};
+
+		static const char* fSkipSpace(const char* aBegin, const char* aEnd) {
+			while (aBegin < aEnd && isspace(static_cast<unsigned char>(*aBegin))) {
+				++aBegin;
 			}
-			aStream >> aBrokenDownTime->tm_mon;
-			if (aStream.fail() || aStream.get() != '/') {
+			return aBegin;
+		}
+		static bool fParseDigits(const char*& aBegin, const char* aEnd, int& aNumber) {
+			if (aBegin == aEnd || !isdigit(static_cast<unsigned char>(*aBegin))) {
 				return false;
 			}
-			aStream >> aBrokenDownTime->tm_mday;
-			if (aStream.fail()) {
+			long long number = 0;
+			for (; aBegin < aEnd && isdigit(static_cast<unsigned char>(*aBegin)); ++aBegin) {
+				if (number < std::numeric_limits<int>::max()) {
+					number = number * 10 + (*aBegin - '0');
+				}
+			}
+			if (number > std::numeric_limits<int>::max()) {
 				return false;
 			}
-			aStream >> aBrokenDownTime->tm_hour;
-			if (!aStream.fail()) {
-				if (aStream.get() != ':') {
+			aNumber = number;
+			return true;
+		}
+		/// parse up to nine digits after the decimal point as nanoseconds, further digits are ignored
+		static long long fParseNanoSeconds(const char*& aBegin, const char* aEnd) {
+			long long nanoSeconds = 0;
+			int digits = 0;
+			for (; aBegin < aEnd && isdigit(static_cast<unsigned char>(*aBegin)); ++aBegin) {
+				if (digits < 9) {
+					nanoSeconds = nanoSeconds * 10 + (*aBegin - '0');
+					++digits;
+				}
+			}
+			return nanoSeconds * kPowersOfTen[9 - digits];
+		}
+
+		/// a time point given by numbers, either as yyyy/mm/dd [HH:MM[:SS[.fff]]] [zone] or as ISO 8601
+		/// yyyy-mm-dd[THH:MM[:SS[.fff]]][Z|+hh[:mm]], out of range fields are normalised like mktime does
+		class numericTimePoint {
+		  public:
+			std::tm lBrokenDownTime;
+			long long lNanoSeconds;
+			bool lHasUtcOffset;
+			long lUtcOffset;
+			const char* lZoneBegin;
+			const char* lZoneEnd;
+
+			bool fParse(const char* aBegin, const char* aEnd) {
+				memset(&lBrokenDownTime, 0, sizeof(lBrokenDownTime));
+				lNanoSeconds = 0;
+				lHasUtcOffset = false;
+				lUtcOffset = 0;
+				lZoneBegin = lZoneEnd = aEnd;
+
+				auto c = fSkipSpace(aBegin, aEnd);
+				bool negativeYear = c < aEnd && *c == '-';
+				if (negativeYear || (c < aEnd && *c == '+')) {
+					++c;
+				}
+				int year, month, day;
+				if (!fParseDigits(c, aEnd, year) || c == aEnd || (*c != '/' && *c != '-')) {
 					return false;
 				}
-				aStream >> aBrokenDownTime->tm_min;
-				if (aStream.fail()) {
+				auto separator = *c++;
+				if (!fParseDigits(c, aEnd, month) || c == aEnd || *c++ != separator ||
+				        !fParseDigits(c, aEnd, day)) {
 					return false;
 				}
-				if (aStream.peek() == ':') {
-					aStream.get();
-					aStream >> aFractional;
-					aBrokenDownTime->tm_sec = aFractional;
-					aFractional -= aBrokenDownTime->tm_sec;
-					if (aStream.fail()) {
+				lBrokenDownTime.tm_year = (negativeYear ? -year : year) - 1900;
+				lBrokenDownTime.tm_mon = month - 1;
+				lBrokenDownTime.tm_mday = day;
+
+				auto timeBegin = c;
+				if (c < aEnd && (*c == 'T' || *c == 't') && separator == '-') {
+					++timeBegin;
+				} else {
+					timeBegin = fSkipSpace(c, aEnd);
+				}
+				if (timeBegin < aEnd && isdigit(static_cast<unsigned char>(*timeBegin))) {
+					c = timeBegin;
+					if (!fParseDigits(c, aEnd, lBrokenDownTime.tm_hour) || c == aEnd || *c++ != ':' ||
+					        !fParseDigits(c, aEnd, lBrokenDownTime.tm_min)) {
 						return false;
 					}
+					if (c < aEnd && *c == ':') {
+						++c;
+						if (!fParseDigits(c, aEnd, lBrokenDownTime.tm_sec)) {
+							return false;
+						}
+						if (c < aEnd && (*c == '.' || *c == ',')) {
+							++c;
+							lNanoSeconds = fParseNanoSeconds(c, aEnd);
+						}
+					}
+					if (c < aEnd && (*c == 'Z' || *c == 'z')) {
+						++c;
+						lHasUtcOffset = true;
+					} else if (c < aEnd && (*c == '+' || *c == '-')) {
+						auto sign = *c++ == '-' ? -1 : 1;
+						auto digitsBegin = c;
+						int hours, minutes = 0;
+						if (!fParseDigits(c, aEnd, hours)) {
+							return false;
+						}
+						if (c - digitsBegin == 4) { // +hhmm
+							minutes = hours % 100;
+							hours /= 100;
+						} else if (c < aEnd && *c == ':') {
+							++c;
+							if (!fParseDigits(c, aEnd, minutes)) {
+								return false;
+							}
+						}
+						lHasUtcOffset = true;
+						lUtcOffset = sign * (hours * 3600L + minutes * 60L);
+					}
+				}
+				if (c < aEnd && !isspace(static_cast<unsigned char>(*c))) {
+					return false;
+				}
+				lZoneBegin = fSkipSpace(c, aEnd);
+				for (lZoneEnd = lZoneBegin; lZoneEnd < aEnd && !isspace(static_cast<unsigned char>(*lZoneEnd)); ++lZoneEnd) {
 				}
+				return true;
 			}
-			aStream >> timezone;
+		};
 
-			return true;
+		/// parse "@seconds[.fff]" as for date(1), other number formats are left to std::stod
+		static std::chrono::system_clock::time_point fParseEpochSeconds(const char* aBegin, const char* aEnd) {
+			auto c = aBegin;
+			bool negative = c < aEnd && *c == '-';
+			if (negative || (c < aEnd && *c == '+')) {
+				++c;
+			}
+			auto digitsBegin = c;
+			long long seconds = 0;
+			bool exact = c < aEnd && isdigit(static_cast<unsigned char>(*c));
+			for (; c < aEnd && isdigit(static_cast<unsigned char>(*c)); ++c) {
+				if (seconds > std::numeric_limits<long long>::max() / 100) {
+					exact = false;
+					break;
+				}
+				seconds = seconds * 10 + (*c - '0');
+			}
+			long long nanoSeconds = 0;
+			if (exact && c < aEnd && *c == '.') {
+				++c;
+				nanoSeconds = fParseNanoSeconds(c, aEnd);
+			}
+			if (seconds > std::numeric_limits<long long>::max() / kNanoSecondsPerSecond - 1) {
+				exact = false;
+			}
+			if (exact && c - digitsBegin > 0 && fSkipSpace(c, aEnd) == aEnd) {
+				std::chrono::nanoseconds sinceEpoch = std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoSeconds);
+				return std::chrono::system_clock::from_time_t(0) +
+				       std::chrono::duration_cast<std::chrono::system_clock::duration>(negative ? -sinceEpoch : sinceEpoch);
+			}
+			auto value = std::stod(std::string(aBegin, aEnd));
+			return std::chrono::system_clock::from_time_t(0) +
+			       std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(value));
 		}
 
-		std::chrono::system_clock::time_point fParseTimePointString(const std::string& aString) {
+		enum dateBitType {
+			kNow = 1 << 0,
+			kToday = 1 << 1,
+			kTomorrow = 1 << 2,
+			kYesterday = 1 << 3,
+			kWeekday = 1 << 4,
+			kDay = kToday | kTomorrow | kYesterday | kWeekday,
+			kLast = 1 << 5,
+			kThis = 1 << 6,
+			kNoon = 1 << 7
+		};
+		/// collect the date keywords in the words of aBegin to aEnd, weekdays may be abbreviated to three letters,
+		/// words that are no keywords are ignored. If several day keywords are given the first of
+		/// now, today, yesterday, tomorrow, sunday ... saturday wins.
+		static unsigned int fLexDateKeywords(const char* aBegin, const char* aEnd, int& aWeekDay) {
+			static const char* weekDays[] = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
+			unsigned int dateBits = 0;
+			aWeekDay = 7;
+			for (auto c = aBegin; c < aEnd;) {
+				if (!isalpha(static_cast<unsigned char>(*c))) {
+					++c;
+					continue;
+				}
+				char word[16];
+				std::size_t length = 0;
+				for (; c < aEnd && isalpha(static_cast<unsigned char>(*c)); ++c) {
+					if (length < sizeof(word)) {
+						word[length] = tolower(static_cast<unsigned char>(*c));
+					}
+					++length;
+				}
+				if (length < 3 || length > sizeof(word)) {
+					continue;
+				}
+				switch (word[0]) {
+					case 'l':
+						if (fIsWord(word, length, "last", 4, false)) {
+							dateBits |= kLast;
+						}
+						break;
+					case 'n':
+						if (fIsWord(word, length, "now", 3, false)) {
+							dateBits |= kNow;
+						} else if (fIsWord(word, length, "noon", 4, false)) {
+							dateBits |= kNoon;
+						}
+						break;
+					case 't':
+						if (fIsWord(word, length, "today", 5, false)) {
+							dateBits |= kToday;
+						} else if (fIsWord(word, length, "tomorrow", 8, false)) {
+							dateBits |= kTomorrow;
+						} else if (fIsWord(word, length, "this", 4, false)) {
+							dateBits |= kThis;
+						}
+						break;
+					case 'y':
+						if (fIsWord(word, length, "yesterday", 9, false)) {
+							dateBits |= kYesterday;
+						}
+						break;
+					default:
+						break;
+				}
+				for (int day = 0; day < 7; day++) {
+					if (length <= strlen(weekDays[day]) && memcmp(word, weekDays[day], length) == 0) {
+						dateBits |= kWeekday;
+						aWeekDay = std::min(aWeekDay, day);
+					}
+				}
+			}
+			for (auto bit : {kNow, kToday, kYesterday, kTomorrow}) { // only the most important day keyword counts
+				if (dateBits & bit) {
+					dateBits &= ~(kNow | kDay);
+					dateBits |= bit;
+					break;
+				}
+			}
+			return dateBits;
+		}
+
+		timePointReference::timePointReference():
+			timePointReference(std::chrono::system_clock::now()) {
+		}
+		timePointReference::timePointReference(std::chrono::system_clock::time_point aNow):
+			lNow(aNow),
+			lLocalZone(&timeZone::fGetLocal()) {
+			lLocalZone->fToBrokenDownTime(std::chrono::system_clock::to_time_t(lNow), lLocalNow);
+		}
+
+		static std::chrono::system_clock::time_point fParseTimePoint(const std::string& aString, const timePointReference* aReference) {
+			std::unique_ptr<timePointReference> ownReference; // only relative time points need one
+			auto reference = [aReference, &ownReference]() -> const timePointReference& {
+				if (aReference) {
+					return *aReference;
+				}
+				if (!ownReference) {
+					ownReference.reset(new timePointReference());
+				}
+				return *ownReference;
+			};
+
 			std::string::size_type pointStringStart = 0;
 			std::string::size_type pointStringLength = std::string::npos;
 			std::string::size_type offsetStringStart = std::string::npos;
@@ -212,79 +1085,37 @@ namespace options {
 			}
 
 			std::chrono::system_clock::time_point timePoint;
-			enum dateBitType {
-				kNow = 1 << 0,
-				kToday = 1 << 1,
-				kTomorrow = 1 << 2,
-				kYesterday = 1 << 3,
-				kWeekday = 1 << 4,
-				kDay = kToday | kTomorrow | kYesterday | kWeekday,
-				kLast = 1 << 5,
-				kThis = 1 << 6,
-				kNoon = 1 << 7
-
-			};
 			if (pointStringStart < aString.size()) {
-				auto pointString = aString.substr(pointStringStart, pointStringLength);
-				std::transform(pointString.begin(), pointString.end(), pointString.begin(), ::tolower);
-
-				typename std::underlying_type<dateBitType>::type dateBits = 0;
+				auto pointBegin = aString.data() + pointStringStart;
+				auto pointEnd = pointStringLength < aString.size() - pointStringStart ? pointBegin + pointStringLength : aString.data() + aString.size();
+				numericTimePoint numeric;
 				int weekDay = 0;
-				if (pointString.find("now") != std::string::npos) {
-					dateBits |= kNow;
-				} else if (pointString.find("today") != std::string::npos) {
-					dateBits |= kToday;
-				} else if (pointString.find("yesterday") != std::string::npos) {
-					dateBits |= kYesterday;
-				} else if (pointString.find("tomorrow") != std::string::npos) {
-					dateBits |= kTomorrow;
-				} else if (pointString.find("sun") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 0;
-				} else if (pointString.find("mon") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 1;
-				} else if (pointString.find("tue") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 2;
-				} else if (pointString.find("wed") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 3;
-				} else if (pointString.find("thu") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 4;
-				} else if (pointString.find("fri") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 5;
-				} else if (pointString.find("sat") != std::string::npos) {
-					dateBits |= kWeekday;
-					weekDay = 6;
-				}
-				if (pointString.find("noon") != std::string::npos) {
-					dateBits |= kNoon;
-				}
-				if (pointString.find("last") != std::string::npos) {
-					dateBits |= kLast;
-				}
-				if (pointString.find("this") != std::string::npos) {
-					dateBits |= kThis;
-				}
-
-				if (dateBits != 0) {
-					timePoint = std::chrono::system_clock::now();
+				unsigned int dateBits = 0;
+				if (*pointBegin == '@') { // as for date(1) this is seconds since 1970
+					timePoint = fParseEpochSeconds(pointBegin + 1, pointEnd);
+				} else if (numeric.fParse(pointBegin, pointEnd)) { // direct spec like yyyy/mm/dd [HH:MM:SS]
+					auto nanoSeconds = std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(numeric.lNanoSeconds));
+					if (numeric.lHasUtcOffset) {
+						timePoint = std::chrono::system_clock::from_time_t(fSecondsFromBrokenDownTime(numeric.lBrokenDownTime) - numeric.lUtcOffset) + nanoSeconds;
+					} else {
+						auto& zone = numeric.lZoneEnd - numeric.lZoneBegin > 2 ? timeZone::fGet(std::string(numeric.lZoneBegin, numeric.lZoneEnd)) : timeZone::fGetLocal();
+						timePoint = std::chrono::system_clock::from_time_t(zone.fFromBrokenDownTime(numeric.lBrokenDownTime)) + nanoSeconds;
+					}
+				} else if ((dateBits = fLexDateKeywords(pointBegin, pointEnd, weekDay)) != 0) {
+					auto& ref = reference();
+					timePoint = ref.fGetNow();
 					if (dateBits & kDay) {
-						auto coarse_time = std::chrono::system_clock::to_time_t(timePoint);
-						auto broken_down_time = std::localtime(&coarse_time);
+						auto broken_down_time = ref.fGetLocalNow();
 
-						broken_down_time->tm_sec = 0;
-						broken_down_time->tm_min = 0;
-						broken_down_time->tm_hour = (dateBits & kNoon) ? 12 : 0;
+						broken_down_time.tm_sec = 0;
+						broken_down_time.tm_min = 0;
+						broken_down_time.tm_hour = (dateBits & kNoon) ? 12 : 0;
 						if (dateBits & kYesterday) {
-							broken_down_time->tm_mday--;
+							broken_down_time.tm_mday--;
 						} else if (dateBits & kTomorrow) {
-							broken_down_time->tm_mday++;
+							broken_down_time.tm_mday++;
 						} else if (dateBits & kWeekday) {
-							auto dayOffset = weekDay - broken_down_time->tm_wday;
+							auto dayOffset = weekDay - broken_down_time.tm_wday;
 							if (dateBits & kLast) {
 								if (dayOffset >= 0) {
 									dayOffset -= 7;
@@ -296,74 +1127,27 @@ namespace options {
 									dayOffset += 7;
 								}
 							}
-							broken_down_time->tm_mday += dayOffset;
+							broken_down_time.tm_mday += dayOffset;
 						}
 
-						timePoint = std::chrono::system_clock::from_time_t(std::mktime(broken_down_time));
-					}
-				} else { // no date bits found, we have a direct specification
-					if (pointString[0] == '@') { // as for date(1) this is seconds since 1970
-						auto seconds = std::stod(pointString.substr(1));
-						timePoint =  std::chrono::system_clock::from_time_t(0) +
-						             std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(seconds));
-					} else { // try direct spec like yyy/mm/dd [HH:MM:SS]
-						std::tm broken_down_time;
-						memset(&broken_down_time, 0, sizeof(broken_down_time));
-						double fractionalPart;
-						std::stringstream buf(aString.substr(pointStringStart, pointStringLength));
-						std::string timezone;
-						if (internal::fParseStreamToBrokenDownTime(buf, &broken_down_time, fractionalPart, timezone)) {
-							broken_down_time.tm_year -= 1900;
-							broken_down_time.tm_mon--;
-							broken_down_time.tm_isdst = -1;
-							#ifdef TZFILE_PATH
-							auto oldTZ = getenv("TZ");
-							std::string oldTZstring;
-							if (oldTZ) {
-								oldTZstring = oldTZ;
-							}
-							if (timezone.length() > 2) {
-								std::string tzfilename(TZFILE_PATH);
-								tzfilename += timezone;
-								struct stat s;
-								if (stat(tzfilename.c_str(), &s) < 0) {
-									parser::fGetInstance()->fGetErrorStream() << "can't find timezone file '" << tzfilename << "'\n";
-									parser::fGetInstance()->fComplainAndLeave();
-								}
-								timezone = ":" + timezone;
-								setenv("TZ", timezone.c_str(), true);
-								tzset();
-							}
-							#endif
-							timePoint = std::chrono::system_clock::from_time_t(std::mktime(&broken_down_time));
-							timePoint += std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(fractionalPart));
-							#ifdef TZFILE_PATH
-							if (timezone.length() > 2) {
-								if (oldTZ) {
-									setenv("TZ", oldTZstring.c_str(), true);
-								} else {
-									unsetenv("TZ");
-								}
-							}
-							#endif
-						} else {
-							parser::fGetInstance()->fGetErrorStream() << "Unrecognized time in '" << pointString << "'\n";
-							parser::fGetInstance()->fComplainAndLeave();
-						}
+						timePoint = std::chrono::system_clock::from_time_t(ref.fGetLocalZone().fFromBrokenDownTime(broken_down_time));
 					}
+				} else {
+					throw std::runtime_error("Unrecognized time in '" + std::string(pointBegin, pointEnd) + "'");
 				}
 			} else {
-				timePoint = std::chrono::system_clock::now();
+				timePoint = reference().fGetNow();
 			}
 
 			if (offsetStringStart < aString.size()) {
-				std::chrono::system_clock::duration offset;
-				auto offsetString = aString.substr(offsetStringStart, offsetStringLength);
-				std::transform(offsetString.begin(), offsetString.end(), offsetString.begin(), ::tolower);
-
+				auto offsetBegin = aString.data() + offsetStringStart;
+				auto offsetEnd = offsetStringLength < aString.size() - offsetStringStart ? offsetBegin + offsetStringLength : aString.data() + aString.size();
+				long long seconds;
+				long long nanoSeconds;
 				int months = 0;
 				int years = 0;
-				internal::parseDurationString(offset, offsetString, &months, &years);
+				fParseDuration(offsetBegin, offsetEnd, seconds, nanoSeconds, &months, &years);
+				auto offset = std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoSeconds));
 
 				if (offsetIsNegative) {
 					timePoint -= offset;
@@ -371,22 +1155,59 @@ namespace options {
 					timePoint += offset;
 				}
 				if (months != 0 || years != 0) {
+					auto& localZone = aReference ? aReference->fGetLocalZone() : timeZone::fGetLocal();
 					auto coarse_time = std::chrono::system_clock::to_time_t(timePoint);
 					auto fractionalPart = timePoint - std::chrono::system_clock::from_time_t(coarse_time);
-					auto broken_down_time = std::localtime(&coarse_time);
+					std::tm broken_down_time;
+					localZone.fToBrokenDownTime(coarse_time, broken_down_time);
 					if (offsetIsNegative) {
-						broken_down_time->tm_mon -= months;
-						broken_down_time->tm_year -= years;
+						broken_down_time.tm_mon -= months;
+						broken_down_time.tm_year -= years;
 					} else {
-						broken_down_time->tm_mon += months;
-						broken_down_time->tm_year += years;
+						broken_down_time.tm_mon += months;
+						broken_down_time.tm_year += years;
 					}
-					timePoint = std::chrono::system_clock::from_time_t(std::mktime(broken_down_time));
+					timePoint = std::chrono::system_clock::from_time_t(localZone.fFromBrokenDownTime(broken_down_time));
 					timePoint += fractionalPart;
 				}
 			}
 			return timePoint;
 		}
+
+		const timePointReference* fGetParseTimePointReference() {
+			auto p = parser::fGetInstance();
+			auto parseTime = p != nullptr ? p->fGetParseTime() : nullptr;
+			if (parseTime == nullptr) {
+				return nullptr;
+			}
+			/// the reference of the last parse seen by this thread
+			class parseReference {
+			  public:
+				const parser* lParser;
+				std::chrono::system_clock::time_point lParseTime;
+				std::unique_ptr<timePointReference> lReference;
+			};
+			static thread_local parseReference gLast;
+			if (!gLast.lReference || gLast.lParser != p || gLast.lParseTime != *parseTime) {
+				gLast.lReference.reset(new timePointReference(*parseTime));
+				gLast.lParser = p;
+				gLast.lParseTime = *parseTime;
+			}
+			return gLast.lReference.get();
+		}
+		std::chrono::system_clock::time_point fParseTimePointString(const std::string& aString) {
+			return fParseTimePoint(aString, fGetParseTimePointReference());
+		}
+		std::chrono::system_clock::time_point fParseTimePointString(const std::string& aString, const timePointReference& aReference) {
+			return fParseTimePoint(aString, &aReference);
+		}
+		void fParseTimePointStrings(const std::vector<std::string>& aStrings, std::vector<std::chrono::system_clock::time_point>& aTimePoints, const timePointReference& aReference) {
+			aTimePoints.clear();
+			aTimePoints.reserve(aStrings.size());
+			for (const auto& string : aStrings) {
+				aTimePoints.push_back(fParseTimePoint(string, &aReference));
+			}
+		}
 	} // end of namespace internal
 
 
@@ -428,22 +1249,7 @@ namespace options {
 	}
 
 	void single<std::chrono::system_clock::time_point>::fWriteRange(std::ostream& aStream) const {
-		if (! lRange.empty()) {
-			aStream << "# allowed range is";
-			if (lRange.size() == 2) {
-				aStream << " [";
-				lValuePrinter(aStream, lRange[0]);
-				aStream << ", ";
-				lValuePrinter(aStream, lRange[1]);
-				aStream << "]\n";
-			} else {
-				for (auto& rangeElement : lRange) {
-					lValuePrinter(aStream, rangeElement);
-					aStream << "\n";
-				}
-				aStream << "\n";
-			}
-		}
+		lRange.fWrite(aStream, lValuePrinter);
 	}
 
 	void single<std::chrono::system_clock::time_point>::fWriteValue(std::ostream& aStream) const {
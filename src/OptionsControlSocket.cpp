@@ -0,0 +1,272 @@
+/*
+   Option parser  C++(11) library for parsing command line options
+    Copyright (C) 2016  Juergen Hannappel
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "OptionsControlSocket.h"
+#include <system_error>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef IS_NONBROKEN_SYSTEM
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+namespace options {
+	controlSocket::controlSocket(const parser& aParser, const std::string& aPath,
+	                             std::chrono::milliseconds aIdleTimeout):
+		lParser(aParser),
+		lPath(aPath),
+		lListenFd(-1),
+		lStopPipe{ -1, -1},
+		lSetCount(0),
+		lIdleTimeout(aIdleTimeout) {
+		if (!lParser.fIsParsingDone()) {
+			throw std::logic_error("control socket " + lPath + " created before parsing");
+		}
+		#ifdef IS_NONBROKEN_SYSTEM
+		sockaddr_un address;
+		if (lPath.size() >= sizeof(address.sun_path)) {
+			throw std::runtime_error("control socket path " + lPath + " is too long");
+		}
+		// bind in a directory only we can enter and chmod there, then rename into place:
+		// the process wide umask must not be changed as other threads may create files
+		auto slash = lPath.find_last_of('/');
+		std::string privateDir(slash == std::string::npos ? std::string(".") : lPath.substr(0, slash + 1));
+		privateDir += ".controlSocketXXXXXX";
+		if (mkdtemp(&privateDir[0]) == nullptr) {
+			throw std::system_error(errno, std::system_category(), "can't create directory for control socket " + lPath);
+		}
+		auto boundPath = privateDir + "/s";
+		if (boundPath.size() >= sizeof(address.sun_path)) {
+			rmdir(privateDir.c_str());
+			throw std::runtime_error("control socket path " + lPath + " is too long");
+		}
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, boundPath.c_str(), sizeof(address.sun_path) - 1);
+
+		lListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (lListenFd < 0) {
+			auto error = errno;
+			rmdir(privateDir.c_str());
+			throw std::system_error(error, std::system_category(), "can't create control socket " + lPath);
+		}
+		fcntl(lListenFd, F_SETFD, FD_CLOEXEC);
+		auto result = bind(lListenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		if (result == 0) {
+			result = chmod(boundPath.c_str(), S_IRUSR | S_IWUSR);
+		}
+		if (result == 0) {
+			// replaces a socket left over from a previous run
+			result = rename(boundPath.c_str(), lPath.c_str());
+		}
+		auto error = errno;
+		unlink(boundPath.c_str());
+		rmdir(privateDir.c_str());
+		if (result != 0) {
+			close(lListenFd);
+			throw std::system_error(error, std::system_category(), "can't set up control socket " + lPath);
+		}
+		if (listen(lListenFd, 4) != 0 || pipe(lStopPipe) != 0) {
+			error = errno;
+			close(lListenFd);
+			unlink(lPath.c_str());
+			throw std::system_error(error, std::system_category(), "can't set up control socket " + lPath);
+		}
+		lThread = std::thread(&controlSocket::fRun, this);
+		#else
+		throw std::runtime_error("control sockets are not supported on this system");
+		#endif
+	}
+
+	controlSocket::~controlSocket() {
+		if (lThread.joinable()) {
+			char stop = 's';
+			if (write(lStopPipe[1], &stop, 1) == 1) {
+				lThread.join();
+			} else {
+				lThread.detach();
+			}
+		}
+		for (auto fd : {lListenFd, lStopPipe[0], lStopPipe[1]}) {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+		unlink(lPath.c_str());
+	}
+
+	void controlSocket::fRun() {
+		#ifdef IS_NONBROKEN_SYSTEM
+		for (;;) {
+			pollfd fds[2] = {{lListenFd, POLLIN, 0}, {lStopPipe[0], POLLIN, 0}};
+			if (poll(fds, 2, -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return;
+			}
+			if (fds[1].revents != 0) {
+				return;
+			}
+			auto client = accept(lListenFd, nullptr, nullptr);
+			if (client >= 0) {
+				fServe(client);
+				close(client);
+			}
+		}
+		#endif
+	}
+
+/// handle the commands of one client until it disconnects, stays idle for lIdleTimeout or the socket is shut down
+	void controlSocket::fServe(int aFd) {
+		#ifdef IS_NONBROKEN_SYSTEM
+		#ifdef MSG_NOSIGNAL
+		const int sendFlags = MSG_NOSIGNAL; // a client that went away must not kill us with SIGPIPE
+		#else
+		const int sendFlags = 0;
+		#endif
+		auto timeoutMs = lIdleTimeout.count();
+		timeval sendTimeout;
+		sendTimeout.tv_sec = timeoutMs / 1000;
+		sendTimeout.tv_usec = (timeoutMs % 1000) * 1000;
+		// a client not reading its replies must not block us in send either
+		setsockopt(aFd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+		std::string buffer;
+		char chunk[4096];
+		for (;;) {
+			pollfd fds[2] = {{aFd, POLLIN, 0}, {lStopPipe[0], POLLIN, 0}};
+			auto ready = poll(fds, 2, static_cast<int>(timeoutMs));
+			if (ready < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return;
+			}
+			if (ready == 0) { // idle for too long, give the next client a chance
+				return;
+			}
+			if (fds[1].revents != 0) {
+				return;
+			}
+			auto n = read(aFd, chunk, sizeof(chunk));
+			if (n <= 0) {
+				return;
+			}
+			buffer.append(chunk, n);
+			std::string::size_type lineEnd;
+			while ((lineEnd = buffer.find('\n')) != std::string::npos) {
+				auto command = buffer.substr(0, lineEnd);
+				buffer.erase(0, lineEnd + 1);
+				if (!command.empty() && command.back() == '\r') {
+					command.pop_back();
+				}
+				if (command.empty()) {
+					continue;
+				}
+				std::ostringstream reply;
+				fHandle(command, reply);
+				auto text = reply.str();
+				for (std::string::size_type sent = 0; sent < text.size();) {
+					auto m = send(aFd, text.data() + sent, text.size() - sent, sendFlags);
+					if (m <= 0) {
+						return;
+					}
+					sent += m;
+				}
+			}
+			if (buffer.size() > 65536) { // no sane command is that long
+				return;
+			}
+		}
+		#else
+		static_cast<void>(aFd);
+		#endif
+	}
+
+	base* controlSocket::fFindOption(const std::string& aName) const {
+		return lParser.lOptionIndex.fFind(aName);
+	}
+
+	void controlSocket::fHandle(const std::string& aCommand, std::ostream& aReply) {
+		auto blank = aCommand.find(' ');
+		auto verb = aCommand.substr(0, blank);
+		auto argumentStart = aCommand.find_first_not_of(' ', blank == std::string::npos ? aCommand.size() : blank);
+		auto argument = argumentStart == std::string::npos ? std::string() : aCommand.substr(argumentStart);
+		if (verb == "dump") {
+			for (auto opt : lParser.lOptionIndex.fGetOptions()) {
+				opt->fWriteCfgLines(aReply, opt->lSource.fIsUnset() ? "# " : "");
+			}
+			aReply << "ok\n";
+			return;
+		}
+		std::string name(argument);
+		std::string value;
+		if (verb == "set") {
+			auto assignment = argument.find(lParser.lPrimaryAssignment);
+			if (assignment == std::string::npos) {
+				aReply << "error: set needs name" << lParser.lPrimaryAssignment << "value\n";
+				return;
+			}
+			name = argument.substr(0, assignment);
+			value = argument.substr(assignment + 1);
+		} else if (verb != "get" && verb != "source") {
+			aReply << "error: unknown command '" << verb << "', known are get, set, dump and source\n";
+			return;
+		}
+		auto opt = fFindOption(name);
+		if (opt == nullptr) {
+			aReply << "error: unknown option '" << name << "'\n";
+			return;
+		}
+		if (verb == "get") {
+			opt->fWriteValue(aReply);
+			aReply << "\nok\n";
+		} else if (verb == "source") {
+			if (opt->lSource.fIsUnset()) {
+				aReply << "unset\nok\n";
+			} else {
+				aReply << opt->lSource << "\nok\n";
+			}
+		} else {
+			auto live = dynamic_cast<internal::liveTunableBase*>(opt);
+			if (live == nullptr) {
+				aReply << "error: option '" << name << "' can not be changed at runtime\n";
+				return;
+			}
+			try {
+				live->fRetune(value, internal::sourceItem(&internal::sourceFile::gControlSocket, lSetCount + 1));
+			} catch (const internal::rangeError&) {
+				aReply << "error: value '" << value << "' out of range for option '" << name << "'\n";
+				return;
+			} catch (const internal::conversionError&) {
+				aReply << "error: can not convert '" << value << "' for option '" << name << "'\n";
+				return;
+			} catch (const std::exception& e) {
+				aReply << "error: " << e.what() << " in option '" << name << "'\n";
+				return;
+			}
+			lSetCount++;
+			aReply << "ok\n";
+		}
+	}
+} // end of namespace options
@@ -0,0 +1,348 @@
+/*
+   Option parser  C++(11) library for parsing command line options
+    Copyright (C) 2016  Juergen Hannappel
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "OptionsHotReload.h"
+#include <memory>
+#include <system_error>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace options {
+	namespace internal {
+		/// parserContext for option copies, which reads the config files from the search paths like the global parser
+		class stagingContext: public parserContext {
+		  public:
+			stagingContext(const std::vector<std::string>& aSearchPaths):
+				parserContext("", "", aSearchPaths) {
+				lMayMapCfgFiles = false; // the files are read because they are being rewritten
+			};
+			using parserContext::fLeave;
+		};
+
+		/// stands in for options that can not be copied, accepting and ignoring their values
+		class placeholderOption: public base {
+		  protected:
+			bool lSetFromCfgFile;
+		  public:
+			placeholderOption(char aShortName, const std::string& aLongName, short aNargs):
+				base(aShortName, aLongName, "", aNargs),
+				lSetFromCfgFile(false) {
+			};
+			void fSetSource(const sourceItem& aSource) override {
+				base::fSetSource(aSource);
+				if (!aSource.fIsUnset() && aSource.fGetFile() != &sourceFile::gCmdLine) {
+					lSetFromCfgFile = true;
+				}
+			};
+			void fSetMe(std::istream& aStream, const sourceItem& aSource) override {
+				aStream.ignore(std::numeric_limits<std::streamsize>::max());
+				fSetSource(aSource);
+			};
+			void fSetMeNoarg(const sourceItem& aSource) override {
+				fSetSource(aSource);
+			};
+			/// true if a config file gave a value, which is then ignored
+			bool fIsSetFromCfgFile() const {
+				return lSetFromCfgFile;
+			};
+			void fCheckRange() const override {};
+			void fAddToRangeFromStream(std::istream& /*aStream*/) override {};
+			void fAddDefaultFromStream(std::istream& /*aStream*/) override {};
+			void fWriteValue(std::ostream& /*aStream*/) const override {};
+		};
+
+		cfgSnapshot::cfgSnapshot():
+			lContext(nullptr) {
+		}
+		cfgSnapshot::~cfgSnapshot() {
+			for (auto copy : lCopies) { // the copies refer to their context, so they go first
+				delete copy;
+			}
+			delete lContext;
+		}
+	} // end of namespace internal
+
+	cfgWatcher::cfgWatcher(const parser& aParser):
+		lParser(aParser),
+		lDefaults(nullptr),
+		lCurrent(nullptr),
+		lEpoch(0),
+		lGeneration(0),
+		lEventFd(-1),
+		lStopFd(-1),
+		lInotifyFd(-1) {
+		lReaders[0].store(0);
+		lReaders[1].store(0);
+	}
+
+	cfgWatcher::~cfgWatcher() {
+		if (lThread.joinable()) {
+			std::uint64_t one = 1;
+			if (write(lStopFd, &one, sizeof(one)) == sizeof(one)) {
+				lThread.join();
+			} else {
+				lThread.detach();
+			}
+		}
+		for (auto fd : {lEventFd, lStopFd, lInotifyFd}) {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+		delete lCurrent.load();
+		delete lDefaults;
+	}
+
+	std::string cfgWatcher::fGetLastError() const {
+		std::lock_guard<std::mutex> lock(lLastErrorMutex);
+		return lLastError;
+	}
+
+/// \brief copy the options of aTemplate, with their values, into a new snapshot with a stagingContext
+
+/// The copies get the positional numbers and the require/forbid rules of the
+/// global options they stand for, aSearchPaths are given to the new context.
+	internal::cfgSnapshot* cfgWatcher::fMakeCopies(const internal::cfgSnapshot& aTemplate, const std::vector<std::string>& aSearchPaths) const {
+		std::unique_ptr<internal::cfgSnapshot> snapshot(new internal::cfgSnapshot);
+		auto context = new internal::stagingContext(aSearchPaths);
+		snapshot->lContext = context;
+		snapshot->lOriginals = aTemplate.lOriginals;
+		std::map<const base*, const base*> copyOf;
+		for (std::size_t i = 0; i < aTemplate.lOriginals.size(); i++) {
+			auto original = aTemplate.lOriginals[i];
+			auto source = aTemplate.lCopies.empty() ? original : aTemplate.lCopies[i];
+			auto copy = source->fMakeStagingCopy();
+			if (copy == nullptr) {
+				copy = new internal::placeholderOption(original->lShortName, original->lLongName.fGetString(), original->lNargs);
+			}
+			snapshot->lCopies.push_back(copy);
+			copy->lIsPositional = original->lIsPositional;
+			copy->lPositionalNumber = original->lPositionalNumber;
+			copyOf.emplace(original, copy);
+		}
+		context->fLeave();
+
+		auto translate = [&copyOf](const std::vector<const base*>& aOptions) {
+			std::vector<const base*> copies;
+			for (auto opt : aOptions) {
+				auto it = copyOf.find(opt);
+				if (it != copyOf.end()) {
+					copies.push_back(it->second);
+				}
+			}
+			return copies;
+		};
+		for (std::size_t i = 0; i < aTemplate.lOriginals.size(); i++) {
+			snapshot->lCopies[i]->lRequiredOptions = translate(aTemplate.lOriginals[i]->lRequiredOptions);
+			snapshot->lCopies[i]->lForbiddenOptions = translate(aTemplate.lOriginals[i]->lForbiddenOptions);
+		}
+		auto required = translate(std::vector<const base*>(lParser.lRequiredOptions.cbegin(), lParser.lRequiredOptions.cend()));
+		context->lRequiredOptions.insert(required.cbegin(), required.cend());
+		for (const auto& group : lParser.lOptionGroups) {
+			context->lOptionGroups.emplace_back(group.lConstraint, translate(group.lOptions));
+		}
+		context->fSetAssignmentChars(lParser.lPrimaryAssignment, lParser.lSecondaryAssignment);
+		context->lMinusMinusJustEndsOptions = lParser.lMinusMinusJustEndsOptions;
+		return snapshot.release();
+	}
+
+/// called by the parser when it starts parsing, i.e. while the options still have their defaults
+	void cfgWatcher::fRememberDefaults(int argc, const char *argv[]) {
+		lArgs.assign(argv, argv + argc);
+		internal::cfgSnapshot originals;
+		for (auto opt : lParser.lOptionIndex.fGetOptions()) {
+			originals.lOriginals.push_back(opt);
+		}
+		lDefaults = fMakeCopies(originals, {});
+	}
+
+/// called by the parser when parsing succeeded, aFileNames are the config files it read or looked for
+	void cfgWatcher::fStart(const std::vector<std::string>& aFileNames) {
+		#ifdef __linux__
+		lInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		lEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		lStopFd = eventfd(0, EFD_CLOEXEC);
+		if (lInotifyFd < 0 || lEventFd < 0 || lStopFd < 0) {
+			throw std::system_error(errno, std::system_category(), "can't set up watching the config files");
+		}
+		fWatch(aFileNames);
+		lThread = std::thread(&cfgWatcher::fRun, this);
+		#else
+		static_cast<void>(aFileNames); // no inotify, reloads only via fReload()
+		#endif
+	}
+
+/// watch the directories of aFileNames, so files that are replaced by renaming are noticed as well
+	void cfgWatcher::fWatch(const std::vector<std::string>& aFileNames) {
+		#ifdef __linux__
+		std::lock_guard<std::mutex> lock(lWatchMutex);
+		for (const auto& fileName : aFileNames) {
+			if (lWatchedFiles.count(fileName) != 0) {
+				continue;
+			}
+			auto slash = fileName.find_last_of('/');
+			auto directory = slash == std::string::npos ? std::string(".") : fileName.substr(0, slash + 1);
+			auto wd = inotify_add_watch(lInotifyFd, directory.c_str(),
+			                            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+			if (wd >= 0) { // missing directories can not be watched, they are tried again after the next reload
+				lWatchedFiles.insert(fileName);
+				lWatchedDirectories[wd].insert(slash == std::string::npos ? fileName : fileName.substr(slash + 1));
+			}
+		}
+		#else
+		static_cast<void>(aFileNames);
+		#endif
+	}
+
+	void cfgWatcher::fRun() {
+		#ifdef __linux__
+		pollfd fds[2] = {{lInotifyFd, POLLIN, 0}, {lStopFd, POLLIN, 0}};
+		alignas(inotify_event) char buffer[4096];
+		int timeout = -1; // after a change wait until things calm down, changes rarely come alone
+		bool changed = false;
+		for (;;) {
+			auto ready = poll(fds, 2, timeout);
+			if (ready < 0 && errno != EINTR) {
+				return;
+			}
+			if (fds[1].revents != 0) {
+				return;
+			}
+			if (ready == 0) {
+				fReload();
+				changed = false;
+				timeout = -1;
+				continue;
+			}
+			for (;;) {
+				auto n = read(lInotifyFd, buffer, sizeof(buffer));
+				if (n <= 0) {
+					break;
+				}
+				std::lock_guard<std::mutex> lock(lWatchMutex);
+				for (auto p = buffer; p < buffer + n;) {
+					auto event = reinterpret_cast<const inotify_event*>(p);
+					auto directory = lWatchedDirectories.find(event->wd);
+					if (event->len > 0 && directory != lWatchedDirectories.end() &&
+					        directory->second.count(event->name) != 0) {
+						changed = true;
+					}
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+			if (changed) {
+				timeout = 50;
+			}
+		}
+		#endif
+	}
+
+	bool cfgWatcher::fReload() {
+		std::lock_guard<std::mutex> lock(lReloadMutex);
+		if (lDefaults == nullptr) {
+			return false;
+		}
+		std::unique_ptr<internal::cfgSnapshot> staging(fMakeCopies(*lDefaults, lParser.lSearchPaths));
+		std::vector<const char*> argv;
+		for (const auto& arg : lArgs) {
+			argv.push_back(arg.c_str());
+		}
+		argv.push_back(nullptr);
+		try {
+			staging->lContext->fParse(static_cast<int>(lArgs.size()), argv.data());
+		} catch (const std::exception& e) {
+			std::lock_guard<std::mutex> errorLock(lLastErrorMutex);
+			lLastError = e.what();
+			return false;
+		}
+		fWatch(staging->lContext->fGetCfgFileNames());
+		std::string ignored;
+		for (auto copy : staging->lCopies) {
+			auto placeholder = dynamic_cast<const internal::placeholderOption*>(copy);
+			if (placeholder != nullptr && placeholder->fIsSetFromCfgFile()) {
+				ignored += " --" + placeholder->fGetLongName();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> errorLock(lLastErrorMutex);
+			lLastError.clear();
+			if (!ignored.empty()) {
+				lLastError = "these options can not be reloaded and keep the values of the startup:" + ignored;
+			}
+		}
+		fPublish(staging.release());
+		return true;
+	}
+
+/// make aSnapshot the current one and delete the previous one once its readers are gone
+
+/// Readers register in the slot of the parity of the epoch, then check the epoch is unchanged.
+/// After switching the snapshot the epoch is advanced, so new readers use the other slot and
+/// only those readers that may still use the previous snapshot are waited for.
+	void cfgWatcher::fPublish(const internal::cfgSnapshot* aSnapshot) {
+		auto previous = lCurrent.exchange(aSnapshot);
+		auto epoch = lEpoch.fetch_add(1);
+		lGeneration.fetch_add(1);
+		if (lEventFd >= 0) {
+			std::uint64_t one = 1;
+			if (write(lEventFd, &one, sizeof(one)) != sizeof(one)) {
+				// the counter is saturated, the reader is signalled anyway
+			}
+		}
+		while (lReaders[epoch & 1].load() != 0) {
+			std::this_thread::yield();
+		}
+		delete previous;
+	}
+
+	cfgWatcher::reader::reader(const cfgWatcher& aWatcher):
+		lWatcher(aWatcher) {
+		for (;;) {
+			auto epoch = lWatcher.lEpoch.load();
+			lReaderSlot = epoch & 1;
+			lWatcher.lReaders[lReaderSlot].fetch_add(1);
+			if (lWatcher.lEpoch.load() == epoch) {
+				break;
+			}
+			lWatcher.lReaders[lReaderSlot].fetch_sub(1); // a snapshot was published meanwhile
+		}
+		lSnapshot = lWatcher.lCurrent.load();
+	}
+	cfgWatcher::reader::~reader() {
+		lWatcher.lReaders[lReaderSlot].fetch_sub(1);
+	}
+
+	const base* cfgWatcher::reader::fGetCopy(const base& aOption) const {
+		if (lSnapshot == nullptr) {
+			return nullptr;
+		}
+		const auto& originals = lSnapshot->lOriginals;
+		auto position = aOption.lIndexPosition;
+		if (position >= originals.size() || originals[position] != &aOption) {
+			position = std::find(originals.cbegin(), originals.cend(), &aOption) - originals.cbegin();
+			if (position == originals.size()) {
+				return nullptr;
+			}
+		}
+		return lSnapshot->lCopies[position];
+	}
+} // end of namespace options
@@ -19,16 +19,29 @@
 #define __Options_H__
 
 #include <limits>
+#include <chrono>
 #include <string>
+#include <stdexcept>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <deque>
 #include <set>
+#include <bitset>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <typeinfo>
 #include <functional>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace options {
 	namespace internal {
@@ -40,6 +53,7 @@ namespace options {
 		  public:
 			static const sourceFile gUnsetSource;
 			static const sourceFile gCmdLine;
+			static const sourceFile gControlSocket;
 			sourceFile(const std::string& aName, decltype(lParent) aParent):
 				lName(aName),
 				lParent(aParent) {
@@ -47,6 +61,9 @@ namespace options {
 			const std::string& fGetName() const {
 				return lName;
 			};
+			const sourceFile& fGetParent() const {
+				return lParent;
+			};
 		};
 
 		/// class to remember from which line (or item) of a file/line an option was set from
@@ -71,8 +88,111 @@ namespace options {
 				return lFile == &sourceFile::gUnsetSource;
 			}
 		};
+
+		/// \brief storage for the strings made while parsing, which are all released when the arena is destructed
+		/// \details Equal strings are stored only once and the chars never move, so the pointers
+		/// handed out stay valid as long as the arena exists. The strings are NUL terminated.
+		class stringArena {
+		  protected:
+			class charSpan {
+			  public:
+				const char* lData;
+				std::size_t lLength;
+				bool operator==(const charSpan& aOther) const {
+					return lLength == aOther.lLength && std::char_traits<char>::compare(lData, aOther.lData, lLength) == 0;
+				};
+			};
+			class spanHash {
+			  public:
+				std::size_t operator()(const charSpan& aSpan) const;
+			};
+			static constexpr std::size_t kBlockSize = 4096;
+			std::vector<std::unique_ptr<char[]>> lBlocks;
+			char* lFree; ///< unused rest of the last block
+			std::size_t lFreeSize;
+			std::unordered_set<charSpan, spanHash> lStrings;
+		  public:
+			stringArena():
+				lFree(nullptr),
+				lFreeSize(0) {
+			};
+			stringArena(const stringArena&) = delete;
+			stringArena& operator=(const stringArena&) = delete;
+			/// the chars of aString in the arena, the same pointer for equal strings
+			const char* fIntern(const std::string& aString);
+			/// number of different strings stored
+			std::size_t fGetSize() const {
+				return lStrings.size();
+			};
+		};
+
+		/// \brief name or explanation of an option
+		/// \details refers to the chars of an optionDescriptor, which have static storage duration,
+		/// or keeps an own copy when constructed from a std::string. In both cases the chars are NUL terminated.
+		class optionName {
+		  protected:
+			const char* lData;
+			std::size_t lLength;
+			mutable std::string lString; ///< the own copy, or the chars of the descriptor once fMaterialize() was called
+		  public:
+			optionName(const std::string& aString):
+				lData(nullptr),
+				lLength(aString.size()),
+				lString(aString) {
+				lData = lString.c_str();
+			};
+			optionName(const char* aStaticChars, std::size_t aLength):
+				lData(aStaticChars),
+				lLength(aLength) {
+			};
+			optionName(const optionName&) = delete;
+			optionName& operator=(const optionName&) = delete;
+			const char* fGetData() const {
+				return lData;
+			};
+			std::size_t fGetLength() const {
+				return lLength;
+			};
+			bool fEquals(const char* aName, std::size_t aLength) const {
+				return lLength == aLength && std::char_traits<char>::compare(lData, aName, aLength) == 0;
+			};
+			/// \brief make the std::string copy of descriptor chars
+			/// \details done by optionIndex::fBuild on the parsing thread, so that
+			/// fGetString() only reads later on, even from watcher or control socket threads
+			void fMaterialize() const {
+				if (lString.size() != lLength) {
+					lString.assign(lData, lLength);
+				}
+			};
+			/// the name as std::string, which for descriptor names is only made on demand
+			const std::string& fGetString() const {
+				fMaterialize();
+				return lString;
+			};
+		};
+		inline std::ostream& operator<<(std::ostream& aStream, const optionName& aName) {
+			return aStream << aName.fGetData();
+		}
+
+		/// FNV-1a hash of the aLength chars at aName, the compile time twin of optionIndex::fHash()
+		constexpr std::uint32_t fHashName(const char* aName, std::size_t aLength, std::uint32_t aHash = 2166136261u) {
+			return aLength == 0 ? aHash : fHashName(aName + 1, aLength - 1, (aHash ^ static_cast<unsigned char>(*aName)) * 16777619u);
+		}
+		/// compare two NUL terminated strings at compile time
+		constexpr bool fNamesAreEqual(const char* aLeft, const char* aRight) {
+			return *aLeft == *aRight && (*aLeft == '\0' || fNamesAreEqual(aLeft + 1, aRight + 1));
+		}
+
+		class optionIndex;
+		class positional_base;
+		class positionalStream;
+		class optionSet;
+		class compiledConstraints;
 	} // end of namespace internal
 
+	class parser;
+	class cfgWatcher;
+	class controlSocket;
 	std::ostream& operator<< (std::ostream &aStream, const internal::sourceItem& aItem);
 	namespace escapedIO {
 		std::istream& operator>> (std::istream &aStream, const char*& aCstring);
@@ -232,6 +352,102 @@ namespace options {
 		std::istream& operator>>(std::istream& aStream, std::string& aString);
 	} // end of namespace escapedIO
 
+	namespace internal {
+		/// read-only stream buffer on the chars in [aBegin,aEnd), which are not copied
+		class charRangeBuf: public std::streambuf {
+		  public:
+			charRangeBuf(const char* aBegin, const char* aEnd) {
+				setg(const_cast<char*>(aBegin), const_cast<char*>(aBegin), const_cast<char*>(aEnd));
+			};
+		};
+
+		/// true for the types that fConvertNumber() can convert without a stream, i.e.
+		/// arithmetic types except bool and the character types, which streams read as characters
+		template <typename T> class hasDirectConversion: public std::integral_constant < bool,
+			std::is_floating_point<T>::value ||
+			(std::is_integral<T>::value &&
+			 !std::is_same<T, bool>::value &&
+			 !std::is_same<T, char>::value &&
+			 !std::is_same<T, signed char>::value &&
+			 !std::is_same<T, unsigned char>::value &&
+			 !std::is_same<T, wchar_t>::value &&
+			 !std::is_same<T, char16_t>::value &&
+			 !std::is_same<T, char32_t>::value) > {
+		};
+
+		/// white space as seen by std::istream in the "C" locale
+		inline bool fIsWhiteSpace(char aChar) {
+			return aChar == ' ' || (aChar >= '\t' && aChar <= '\r');
+		}
+		/// skip white space as std::istream would do, return pointer to first non-space char
+		inline const char* fSkipWhiteSpace(const char* aBegin, const char* aEnd) {
+			while (aBegin != aEnd && fIsWhiteSpace(*aBegin)) {
+				++aBegin;
+			}
+			return aBegin;
+		}
+
+		/// \brief convert the beginning of [aBegin,aEnd) into aValue
+		/// \details accepts what operator>> with std::setbase(0) accepts, i.e. an optional sign
+		/// followed by a hexadecimal (0x), octal (leading 0) or decimal number. Trailing chars are not consumed.
+		/// \result pointer behind the consumed chars or nullptr if the conversion failed, then aValue is unchanged
+		template <typename T> typename std::enable_if<std::is_integral<T>::value, const char*>::type fConvertNumber(const char* aBegin, const char* aEnd, T& aValue) {
+			auto p = aBegin;
+			bool negative = false;
+			if (p != aEnd && (*p == '-' || *p == '+')) {
+				negative = *p == '-';
+				++p;
+			}
+			unsigned int base = 10;
+			bool foundZero = false;
+			if (p != aEnd && *p == '0') {
+				++p;
+				if (p != aEnd && (*p == 'x' || *p == 'X')) {
+					++p;
+					base = 16;
+				} else {
+					base = 8;
+					foundZero = true;
+				}
+			}
+			typedef typename std::make_unsigned<T>::type unsignedType;
+			unsignedType limit = std::numeric_limits<T>::max();
+			if (std::is_signed<T>::value && negative) {
+				limit += 1;
+			}
+			unsignedType magnitude = 0;
+			bool foundDigit = false;
+			for (; p != aEnd; ++p) {
+				unsigned int digit;
+				if (*p >= '0' && *p <= '9') {
+					digit = *p - '0';
+				} else if (*p >= 'a' && *p <= 'f') {
+					digit = *p - 'a' + 10;
+				} else if (*p >= 'A' && *p <= 'F') {
+					digit = *p - 'A' + 10;
+				} else {
+					break;
+				}
+				if (digit >= base) {
+					break;
+				}
+				if (magnitude > (limit - digit) / base) {
+					return nullptr; // overflow
+				}
+				magnitude = magnitude * base + digit;
+				foundDigit = true;
+			}
+			if (!foundDigit && !foundZero) {
+				return nullptr;
+			}
+			aValue = static_cast<T>(negative ? static_cast<unsignedType>(0 - magnitude) : magnitude);
+			return p;
+		}
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, float& aValue);
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, double& aValue);
+		const char* fConvertNumber(const char* aBegin, const char* aEnd, long double& aValue);
+	} // end of namespace internal
+
 	/// template interface class for options that provide a value printer
 
 	template <typename T> class valuePrinter {
@@ -248,6 +464,79 @@ namespace options {
 	};
 
 
+/// compile time declaration of the names and the explanation of an option
+
+/// Options are usually declared with their names given as std::string, which are copied
+/// into the option. Options can instead be declared in a constexpr table of descriptors,
+/// which they refer to instead, so no allocation is needed for their registration and the
+/// table can be checked for duplicate names at compile time:
+/// \code
+/// static constexpr options::optionDescriptor gOptionTable[] = {
+/// 	{'n', "number", "some number"},
+/// 	{'\0', "names", "a list of names"}
+/// };
+/// static_assert(options::optionDescriptor::fAreUnique(gOptionTable), "option names clash");
+/// static options::single<int> gNumber(options::optionDescriptor::fFind(gOptionTable, "number"), 42);
+/// static options::container<std::string> gNames(gOptionTable[1]);
+/// \endcode
+/// As the options refer to the descriptors these must have static storage duration.
+	class optionDescriptor {
+	  public:
+		char lShortName;
+		const char* lLongName;
+		std::size_t lLongNameLength;
+		const char* lExplanation;
+		std::size_t lExplanationLength;
+		std::uint32_t lHash; ///< hash of the long name as used by the option index of the parser
+		template <std::size_t N, std::size_t M> constexpr optionDescriptor(char aShortName, const char (&aLongName)[N], const char (&aExplanation)[M]):
+			lShortName(aShortName),
+			lLongName(aLongName),
+			lLongNameLength(N - 1),
+			lExplanation(aExplanation),
+			lExplanationLength(M - 1),
+			lHash(internal::fHashName(aLongName, N - 1)) {
+		};
+		/// true if neither long nor (if given) short name equals the one of aOther
+		constexpr bool fDoesNotClashWith(const optionDescriptor& aOther) const {
+			return (lHash != aOther.lHash || !internal::fNamesAreEqual(lLongName, aOther.lLongName)) &&
+			       (lShortName == '\0' || lShortName != aOther.lShortName);
+		};
+		/// \brief true if the descriptors in [aBegin,aEnd) of aTable do not clash with aTable[aIndex]
+		/// \details The ranges are split in halves, so the recursion depth of this and the following
+		/// functions only grows with the logarithm of the table size.
+		template <std::size_t N> static constexpr bool fDoesNotClash(const optionDescriptor (&aTable)[N], std::size_t aIndex,
+		        std::size_t aBegin, std::size_t aEnd) {
+			return aEnd - aBegin > 1 ?
+			       fDoesNotClash(aTable, aIndex, aBegin, aBegin + (aEnd - aBegin) / 2) && fDoesNotClash(aTable, aIndex, aBegin + (aEnd - aBegin) / 2, aEnd) :
+			       aEnd == aBegin || aTable[aBegin].fDoesNotClashWith(aTable[aIndex]);
+		};
+		/// true if no two descriptors in aTable have the same long or short name, meant for use in static_assert
+		template <std::size_t N> static constexpr bool fAreUnique(const optionDescriptor (&aTable)[N], std::size_t aBegin = 0, std::size_t aEnd = N) {
+			return aEnd - aBegin > 1 ?
+			       fAreUnique(aTable, aBegin, aBegin + (aEnd - aBegin) / 2) && fAreUnique(aTable, aBegin + (aEnd - aBegin) / 2, aEnd) :
+			       aEnd == aBegin || fDoesNotClash(aTable, aBegin, 0, aBegin);
+		};
+		/// position of the descriptor with long name aLongName in [aBegin,aEnd) of aTable, N if there is none
+		template <std::size_t N> static constexpr std::size_t fPositionOf(const optionDescriptor (&aTable)[N], const char* aLongName,
+		        std::size_t aBegin = 0, std::size_t aEnd = N) {
+			return aEnd - aBegin > 1 ?
+			       fFirstFound(fPositionOf(aTable, aLongName, aBegin, aBegin + (aEnd - aBegin) / 2), fPositionOf(aTable, aLongName, aBegin + (aEnd - aBegin) / 2, aEnd), N) :
+			       (aEnd > aBegin && internal::fNamesAreEqual(aTable[aBegin].lLongName, aLongName)) ? aBegin : N;
+		};
+		/// \brief the descriptor with long name aLongName in aTable
+		/// \details an unknown name is a compile time error when used in a constant expression, else a std::logic_error is thrown
+		template <std::size_t N> static constexpr const optionDescriptor& fFind(const optionDescriptor (&aTable)[N], const char* aLongName) {
+			return aTable[fCheckFound(fPositionOf(aTable, aLongName), N)];
+		};
+	  protected:
+		static constexpr std::size_t fFirstFound(std::size_t aFirst, std::size_t aSecond, std::size_t aNotFound) {
+			return aFirst != aNotFound ? aFirst : aSecond;
+		};
+		static constexpr std::size_t fCheckFound(std::size_t aPosition, std::size_t aNotFound) {
+			return aPosition != aNotFound ? aPosition : throw std::logic_error("option not found in descriptor table");
+		};
+	};
+
 /// base class for options
 
 /// Only the templated classes that derive from this base class can contain values.
@@ -255,31 +544,67 @@ namespace options {
 /// on the type of the option.
 	class base {
 		friend class parser;
+		friend class internal::optionIndex;
+		friend class internal::positionalStream;
+		friend class internal::optionSet;
+		friend class internal::compiledConstraints;
+		friend class internal::positional_base;
+		friend class cfgWatcher;
+		friend class controlSocket;
 	  protected:
-		static std::map<std::string, base*>& fGetOptionMap() {
-			static std::map<std::string, base*> gOptions;
-			return gOptions;
-		};
-		static std::map<char, base*>& fGetShortOptionMap() {
-			static std::map<char, base*> gShortOptions;
-			return gShortOptions;
-		};
+		/// \brief first of the options registered with aContext (nullptr for the global option set), which are chained via lNextRegistered
+		/// \details Registration neither allocates memory nor depends on other statics being
+		/// constructed, the option index of the parser is built from this list when needed.
+		static base*& fGetFirstRegistered(parser* aContext);
 	  protected:
 		char lShortName;
-		const std::string lLongName;
-		const std::string lExplanation;
+		const internal::optionName lLongName;
+		const internal::optionName lExplanation;
+		std::uint32_t lHash; ///< hash of the long name as used by the option index of the parser
+		base* lNextRegistered;
+		parser* lContext; ///< the parserContext the option belongs to, nullptr for the global option set
+		bool lIsPositional;
+		int lPositionalNumber; ///< ordering number if lIsPositional
 		internal::sourceItem lSource;
 		short lNargs;
 		bool lHidden;
 		std::vector<std::string>* lPreserveWorthyStuff;
+		std::size_t lIndexPosition; ///< dense index of the option, i.e. its position in the parser's option index
+		bool lConversionIsDeferred;
+		std::string lDeferredValue; ///< text of the value to be converted later, see parser::fSetConversionsAreDeferred()
+		internal::sourceItem lDeferredSource;
 
 		std::vector<const base*> lRequiredOptions;
 		std::vector<const base*> lForbiddenOptions;
+		void fInvalidateConstraints();
 
 		/// function to set the value from a string, remembering the source
 		virtual void fSetMe(std::istream& aStream, const internal::sourceItem& aSource) = 0;
+		/// \brief set the value directly from the chars in [aBegin,aEnd), without a stream
+		/// \details returns false if the option has no such conversion, then fSetMe() is used.
+		/// Classes that override fSetMe() of an option that has one must override this as well.
+		virtual bool fConvertFromString(const char* /*aBegin*/, const char* /*aEnd*/, const internal::sourceItem& /*aSource*/) {
+			return false;
+		};
+		/// set the value from the chars in [aBegin,aEnd), remembering the source
+		void fSetMeFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource);
 		virtual void fSetMeNoarg(const internal::sourceItem& /*aSource*/) {};
 		virtual void fSetSource(const internal::sourceItem& aSource);
+		/// \brief tell if setting this option only sets its value, so the conversion may be deferred
+		/// \details options whose fSetMe() has side effects or whose values are consulted while parsing must return false
+		virtual bool fIsDeferrable() const {
+			return false;
+		};
+		/// set the value from [aBegin,aEnd) and check its range, unless the conversion is deferred
+		void fSetMeFromStringAndCheckRange(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource);
+		/// convert the deferred value, if there is one
+		void fResolveDeferredValue();
+		/// \brief new option with the same names, range and value, registered with the current parserContext
+		/// \details used by cfgWatcher to re-parse into a staging copy, nullptr if the option can not be copied.
+		/// The overrides return nullptr for derived classes, e.g. withAction, whose behaviour a copy would lack.
+		virtual base* fMakeStagingCopy() const {
+			return nullptr;
+		};
 	  private:
 		virtual void fHandleOption(int argc, const char *argv[], int *i);
 
@@ -291,8 +616,11 @@ namespace options {
 		void fHide();
 		bool fIsHidden() const;
 		void fDisable();
+	  private:
+		void fRegister();
 	  public:
 		base(char aShortName, const std::string&  aLongName, const std::string&  aExplanation, short aNargs);
+		base(const optionDescriptor& aDescriptor, short aNargs);
 		virtual ~base();
 
 		/// special for use in the shellScriptOptionParser
@@ -334,7 +662,7 @@ namespace options {
 
 		/// returns long name of option, usually only for internal use.
 		const std::string& fGetLongName() const {
-			return lLongName;
+			return lLongName.fGetString();
 		};
 	};
 
@@ -387,6 +715,13 @@ namespace options {
 				return type;
 			};
 		};
+		/// thrown by parserContext instead of leaving the program, what() tells the error messages
+		class parseError: public std::runtime_error {
+		  public:
+			parseError(const std::string& aWhat) :
+				std::runtime_error(aWhat) {};
+			~parseError() override = default;
+		};
 		template <typename T> void conCatStr(std::ostringstream& msg, const T& begin) {
 			msg << begin;
 		}
@@ -405,14 +740,277 @@ namespace options {
 		}
 
 
+		/// flat lookup table of the registered options
+
+		/// Options only chain themselves into the list of registered options when they are constructed.
+		/// Once the option set is complete (i.e. when parsing starts) the parser freezes it
+		/// into this index: a contiguous, name-sorted table of the options, an open addressing
+		/// hash table over the long names and a direct table for the short names.
+		/// Clashing names are detected while the index is built.
+		class optionIndex {
+		  protected:
+			class slot {
+			  public:
+				std::uint32_t lHash;
+				std::uint32_t lPosition; ///< position in lOptions plus one, zero marks an empty slot
+			};
+			std::vector<base*> lOptions;
+			std::vector<slot> lSlots;
+			base* lShortOptions[256];
+			bool lIsBuilt;
+			std::size_t lGeneration; ///< changes whenever the positions of the options change
+			void fBuildSlots();
+		  public:
+			static std::uint32_t fHash(const char* aName, std::size_t aLength);
+			optionIndex();
+			void fBuild(base* aFirstRegistered);
+			void fRemove(const base* aOption);
+			void fClear();
+			bool fIsBuilt() const {
+				return lIsBuilt;
+			};
+			std::size_t fGetGeneration() const {
+				return lGeneration;
+			};
+			/// find option by long name given as aLength chars at aName, nullptr if unknown
+			base* fFind(const char* aName, std::size_t aLength) const;
+			base* fFind(const std::string& aName) const {
+				return fFind(aName.data(), aName.size());
+			};
+			base* fFindShort(char aShortName) const {
+				return lShortOptions[static_cast<unsigned char>(aShortName)];
+			};
+			/// all options, sorted by their long names
+			const std::vector<base*>& fGetOptions() const {
+				return lOptions;
+			};
+			/// value of base::lIndexPosition for options that are not in the index
+			static constexpr std::size_t gNotIndexed = std::numeric_limits<std::size_t>::max();
+		};
+
+		/// set of options as a bitset over their dense indices, options not in the index are never contained
+		class optionSet {
+		  protected:
+			std::vector<std::uint64_t> lWords;
+		  public:
+			explicit optionSet(std::size_t aNOptions):
+				lWords((aNOptions + 63) / 64, 0) {
+			};
+			void fInsert(const base* aOption) {
+				auto position = aOption->lIndexPosition;
+				if (position != optionIndex::gNotIndexed) {
+					lWords[position / 64] |= std::uint64_t(1) << (position % 64);
+				}
+			};
+			bool fContains(const base* aOption) const {
+				auto position = aOption->lIndexPosition;
+				return position != optionIndex::gNotIndexed && (lWords[position / 64] & (std::uint64_t(1) << (position % 64))) != 0;
+			};
+			/// count the options that are in both sets
+			std::size_t fCountCommon(const optionSet& aOther) const {
+				std::size_t count = 0;
+				for (std::size_t i = 0; i < lWords.size(); i++) {
+					count += std::bitset<64>(lWords[i] & aOther.lWords[i]).count();
+				}
+				return count;
+			};
+			std::size_t fCount() const {
+				return fCountCommon(*this);
+			};
+		};
+
+		/// group of options with a constraint on how many of them may be given
+		class optionGroup {
+		  public:
+			enum class constraint {
+				kExactlyOne,
+				kAtLeastOne,
+				kAtMostOne,
+				kAllOrNone
+			};
+			constraint lConstraint;
+			std::vector<const base*> lOptions;
+			optionGroup(constraint aConstraint, const std::vector<const base*>& aOptions):
+				lConstraint(aConstraint),
+				lOptions(aOptions) {
+			};
+		};
+
+		/// \brief the require/forbid rules and the option groups as bitsets over the option index
+		/// \details Compiled when the index is built and again only if the positions of the options
+		/// or the rules changed, so checking a rule takes a few word operations. The counts include
+		/// disabled options, which are never given.
+		class compiledConstraints {
+		  public:
+			class rule {
+			  public:
+				const base* lOption; ///< the option the rule belongs to
+				optionSet lOthers;
+				std::size_t lNOthers; ///< number of distinct other options
+				rule(const base* aOption, std::size_t aNOptions):
+					lOption(aOption),
+					lOthers(aNOptions),
+					lNOthers(0) {
+				};
+			};
+			class group {
+			  public:
+				optionSet lMembers;
+				std::size_t lNMembers; ///< number of distinct members
+				explicit group(std::size_t aNOptions):
+					lMembers(aNOptions),
+					lNMembers(0) {
+				};
+			};
+		  protected:
+			bool lIsCompiled;
+			std::size_t lIndexGeneration;
+		  public:
+			optionSet lRequired; ///< the options required by the parser
+			std::size_t lNRequired;
+			std::vector<rule> lRequires; ///< the options that require others
+			std::vector<rule> lForbids; ///< the options that forbid others
+			std::vector<group> lGroups; ///< in the order of parser::lOptionGroups
+			compiledConstraints():
+				lIsCompiled(false),
+				lIndexGeneration(0),
+				lRequired(0),
+				lNRequired(0) {
+			};
+			bool fIsCompiledFor(const optionIndex& aIndex) const {
+				return lIsCompiled && lIndexGeneration == aIndex.fGetGeneration();
+			};
+			void fCompile(const optionIndex& aIndex, const std::set<const base*>& aRequired, const std::vector<optionGroup>& aGroups);
+			/// a rule was added
+			void fInvalidate() {
+				lIsCompiled = false;
+			};
+		};
+
+		/// identity of a file as given by stat, used to decide if a cached copy is still valid
+		class fileIdentity {
+		  public:
+			std::uint64_t lDevice;
+			std::uint64_t lInode;
+			std::uint64_t lSize;
+			std::int64_t lModificationSeconds;
+			std::int64_t lModificationNanoSeconds;
+			fileIdentity();
+			/// fill from the file aFileName, returns false if it can't be stat'ed
+			bool fSetFrom(const std::string& aFileName);
+			bool operator==(const fileIdentity& aOther) const {
+				return lDevice == aOther.lDevice && lInode == aOther.lInode && lSize == aOther.lSize
+				       && lModificationSeconds == aOther.lModificationSeconds && lModificationNanoSeconds == aOther.lModificationNanoSeconds;
+			};
+		};
+
+		/// read-only view of the contents of a whole file, memory mapped where possible
+		class fileContent {
+		  protected:
+			const char* lBegin;
+			std::size_t lSize;
+			void* lMapping;
+			std::string lBuffer; ///< used for files that can't be mapped, e.g. pipes
+			fileIdentity lIdentity;
+		  public:
+			fileContent();
+			fileContent(const fileContent&) = delete;
+			fileContent& operator=(const fileContent&) = delete;
+			~fileContent();
+			/// make the contents of aFileName available, returns 0 or the errno value of the failure
+			int fRead(const std::string& aFileName, bool aMayMap = true);
+			const char* fBegin() const {
+				return lBegin;
+			};
+			const char* fEnd() const {
+				return lBegin + lSize;
+			};
+			/// identity of the file as it was when read
+			const fileIdentity& fGetIdentity() const {
+				return lIdentity;
+			};
+		};
+
+		/// the lines of a config file that matter, as kept in the config file cache; they are parsed again on use
+		class cfgCacheEntry {
+		  public:
+			fileIdentity lIdentity;
+			std::string lRecords; ///< sequence of line number, length and text of the line
+		};
+
+		/// append the bytes of aValue to aBuffer, the format of cache files
+		template <typename T> void fAppendBinary(std::string& aBuffer, T aValue) {
+			aBuffer.append(reinterpret_cast<const char*>(&aValue), sizeof(aValue));
+		}
+		/// append aString to aBuffer, preceded by its length
+		void fAppendBinary(std::string& aBuffer, const std::string& aString);
+		/// read a T at aPosition if it fits before aEnd, advancing aPosition
+		template <typename T> bool fExtractBinary(const char*& aPosition, const char* aEnd, T& aValue) {
+			if (static_cast<std::size_t>(aEnd - aPosition) < sizeof(aValue)) {
+				return false;
+			}
+			std::memcpy(&aValue, aPosition, sizeof(aValue));
+			aPosition += sizeof(aValue);
+			return true;
+		}
+		/// read a string written by fAppendBinary if it fits before aEnd, advancing aPosition
+		bool fExtractBinary(const char*& aPosition, const char* aEnd, std::string& aString);
+		/// \brief replace aFileName with aContent via a temporary file, so concurrent readers see either the old or the new one
+		/// \details returns false if that failed, which is no error for caches
+		bool fWriteFileAtomically(const std::string& aFileName, const std::string& aContent);
+
+		/// config file from the search path, read in the background while the application starts up
+		class prefetchedCfgFile {
+		  public:
+			std::string lName;
+			bool lDirectoryExists;
+			int lError; ///< 0 or the errno value of reading the file
+			fileContent lContent;
+			prefetchedCfgFile(const std::string& aName):
+				lName(aName),
+				lDirectoryExists(false),
+				lError(0) {
+			};
+		};
+
 		class positional_base {
 		  public:
+			/// mark aAsBase as positional option, which may also be done by a temporary object
 			positional_base(int aOrderingNumber,
 			                base* aAsBase);
-			static std::map<int, base*>& fGetPositonalArgs() {
-				static std::map<int, base*> gPositinalArgs;
-				return gPositinalArgs;
-			}
+			/// the positional options in the list starting at aFirstRegistered sorted by their ordering numbers, checked for consistency
+			static std::map<int, base*>& fGetPositonalArgs(base* aFirstRegistered);
+		};
+
+		/// distributes positional arguments in one pass over the arguments
+
+		/// Arguments are assigned to the positional options as soon as their slot is known:
+		/// the options in front of the container option take one argument each, the container
+		/// takes everything that is not needed for the options behind it. As these are
+		/// filled from the back, only as many arguments as there are options behind the
+		/// container are held back until the end of the argument list is reached.
+		/// The options other than the container are set only by fFinish(), i.e. after all config
+		/// files are read, so a later --readCfgFile can not override them, as with fDistribute().
+		class positionalStream {
+		  protected:
+			std::vector<base*> lLeading;
+			std::vector<const char*> lLeadingArgs; ///< the arguments for lLeading, set by fFinish()
+			base* lContainer;
+			std::vector<base*> lTrailing;
+			std::vector<const char*> lHeldBack; ///< ring buffer of lTrailing.size() arguments
+			std::size_t lHeldBackStart;
+			std::size_t lHeldBackCount;
+			std::size_t lNextLeading;
+			static void fAssign(base* aOption, const char* aArg);
+		  public:
+			positionalStream();
+			void fSetup(const std::map<int, base*>& aPositionals);
+			/// feed the next argument, returns false if no positional option takes it
+			bool fTake(const char* aArg);
+			/// assign the arguments of the options in front of and behind the container
+			void fFinish();
+			/// assign all aArgs at once, removing the used ones from aArgs
+			static void fDistribute(const std::map<int, base*>& aPositionals, std::vector<const char*>& aArgs);
 		};
 	} // end of namespace internal
 
@@ -424,15 +1022,41 @@ namespace options {
 /// can then be used to parse the command line options.
 
 	class parser {
+		friend class base;
+		friend class cfgWatcher;
+		friend class controlSocket;
 	  protected:
 		static parser* gParser;
+		static thread_local parser* gCurrentContext; ///< innermost parserContext of the calling thread
+		const bool lIsContext;
+		base* lFirstRegistered; ///< options of a parserContext, see base::fGetFirstRegistered()
+		internal::optionIndex lOptionIndex;
 		const std::string lDescription;
 		const std::string lTrailer;
 		const std::vector<std::string> lSearchPaths;
 		std::vector<std::string> lUnusedOptions;
+		std::vector<const char*> lUnusedArgs; ///< views into argv or lStrayCfgLines
+		std::deque<std::string> lStrayCfgLines; ///< non-option lines from config files, element addresses stay valid
 		std::vector<std::string> lStuffAfterMinusMinus;
+		internal::positionalStream lPositionalStream;
+		std::function<void(const char*)> lUnusedArgConsumer;
+		bool lStreamPositionals;
+		std::string lCfgCacheFileName;
+		std::map<std::string, internal::cfgCacheEntry> lCfgCache;
+		bool lCfgCacheIsLoaded;
+		bool lCfgCacheIsDirty;
+		bool lDeferConversions;
+		bool lMayMapCfgFiles; ///< false when the config files may be rewritten while they are read, as on a reload
+		std::deque<internal::prefetchedCfgFile> lPrefetchedCfgFiles; ///< filled by lPrefetchThread
+		std::thread lPrefetchThread;
+		cfgWatcher* lCfgWatcher;
+		std::vector<std::string> lCfgFileNames; ///< all config files that were read or looked for
+		internal::stringArena lStringArena; ///< the strings of const char* options
+		std::deque<internal::sourceFile> lSourceFiles; ///< the config files that options were set from
 
 		std::set<const base*> lRequiredOptions;
+		std::vector<internal::optionGroup> lOptionGroups;
+		internal::compiledConstraints lConstraints;
 
 		bool lMinusMinusJustEndsOptions;
 		std::ostream *lMessageStream;
@@ -444,15 +1068,36 @@ namespace options {
 		char lSecondaryAssignment;
 
 		bool lParsingIsDone;
+		bool lParsingIsRunning;
+		std::chrono::system_clock::time_point lParseTime; ///< "now" for all relative time points of one parse
 
 		void fReadConfigFiles();
+		void fStartPrefetch(const char* aProgName);
+		void fDropPrefetch();
+		void fPrefetchConfigFiles();
+		void fReadCfgFile(const std::string& aFileName, const internal::sourceItem& aSource, bool aMayBeAbsent, const internal::prefetchedCfgFile* aPrefetched);
+		void fHandleUnusedArg(const char* aArg);
+		const internal::sourceFile* fGetSourceFile(const std::string& aFileName, const internal::sourceFile& aParent);
+		void fLoadCfgCache();
+		void fWriteCfgCache();
+		void fResolveDeferredValues();
 		void fPrintOptionHelp(std::ostream& aMessageStream, const base& aOption, std::size_t aMaxName, std::size_t aMaxExplain, size_t lineLenght) const;
 		void fCheckConsistency();
+		const internal::optionIndex& fGetOptionIndex();
+		/// this parser if it is a parserContext, else nullptr, i.e. the owner of its options as in base::lContext
+		parser* fAsContext() {
+			return lIsContext ? this : nullptr;
+		};
+		parser(const std::string& aDescription, const std::string& aTrailer, const std::vector<std::string>& aSearchPaths, bool aIsContext);
 	  public:
 		parser(const std::string& aDescription = "", const std::string& aTrailer = "", const std::vector<std::string>& aSearchPaths = {"/etc/", "~/.", "~/.config/", "./."});
-		~parser();
+		virtual ~parser();
 
 		bool fIsParsingDone() const;
+		/// the time the running fParse() started at, nullptr if it is not running
+		const std::chrono::system_clock::time_point* fGetParseTime() const {
+			return lParsingIsRunning ? &lParseTime : nullptr;
+		};
 
 		void fSetMessageStream(std::ostream* aStream);
 		void fSetErrorStream(std::ostream* aStream);
@@ -468,6 +1113,14 @@ namespace options {
 		}
 		virtual void fRequire(const base* aOtherOption);
 		virtual void fRequire(std::vector<const base*> aOtherOptions);
+		/// require that exactly one of aOptions is given
+		void fRequireExactlyOneOf(std::vector<const base*> aOptions);
+		/// require that at least one of aOptions is given
+		void fRequireAtLeastOneOf(std::vector<const base*> aOptions);
+		/// allow at most one of aOptions to be given
+		void fAllowAtMostOneOf(std::vector<const base*> aOptions);
+		/// require that either all or none of aOptions are given
+		void fRequireAllOrNoneOf(std::vector<const base*> aOptions);
 
 
 		/// parse the options on the command line
@@ -481,8 +1134,12 @@ namespace options {
 		const std::vector<std::string>& fParse(int argc, char *argv[]);
 
 
-		/// get the only allwed instance of the option parser.
+		/// get the only allwed instance of the option parser, or the current parserContext of the calling thread
 		static parser* fGetInstance();
+		/// get the innermost parserContext of the calling thread, nullptr if there is none
+		static parser* fGetCurrentContext() {
+			return gCurrentContext;
+		};
 
 		/// print help, normally automatically called by the --help option or in case of problems.
 		void fHelp();
@@ -496,22 +1153,256 @@ namespace options {
 		const std::vector<std::string>& fGetStuffAfterMinusMinus() {
 			return lStuffAfterMinusMinus;
 		};
+		/// assign positional arguments as soon as their position is known, i.e. while parsing still continues
+
+		/// Normally positional options are set after all other options are parsed. When streaming,
+		/// a positional withAction<container<...>> sees its arguments during parsing, so huge
+		/// argument lists can be consumed (and cleared from the container) on the fly.
+		/// The other positional options are still set after the config files are read.
+		void fSetPositionalsAreStreamed() {
+			lStreamPositionals = true;
+		};
+		/// hand arguments not used by any option to aConsumer instead of collecting them for fParse's result
+		void fSetUnusedArgConsumer(std::function<void(const char*)> aConsumer) {
+			lUnusedArgConsumer = aConsumer;
+		};
+		/// \brief convert option values only once, after all options are parsed
+
+		/// Options that allow it (see base::fIsDeferrable()) then just remember the text and source of their last value,
+		/// so an option set in several config files and on the command line is converted and range checked only once.
+		/// All deferred values are converted together at the end of fParse(), before that every way to read such
+		/// an option, e.g. from the action of another option, gives its previous value.
+		void fSetConversionsAreDeferred() {
+			lDeferConversions = true;
+		};
+		/// keep a binary cache of the lines of the config files read in aFileName
+
+		/// Config files that are unchanged since they were cached (same path, device, inode, size and mtime)
+		/// are then taken from the cache instead of being read again, others are read and the cache is
+		/// updated after a successful parse. Use a file on a local disk, the format is host specific.
+		/// Only the file I/O and the skipping of comment lines are saved: the cache holds the text of the
+		/// relevant lines, not converted values, so every value is still converted and range checked on each
+		/// start, as if the file had been read. Combine with fSetConversionsAreDeferred() to convert each option once.
+		void fSetCfgCacheFile(const std::string& aFileName) {
+			lCfgCacheFileName = aFileName;
+		};
+		/// \brief re-read the config files whenever one of them changes, see cfgWatcher
+		/// \details must be called before fParse(), the watcher is then available via fGetCfgWatcher()
+		void fSetCfgFilesAreWatched();
+		cfgWatcher* fGetCfgWatcher() const {
+			return lCfgWatcher;
+		};
+		/// names of all config files that were read or looked for while parsing
+		const std::vector<std::string>& fGetCfgFileNames() const {
+			return lCfgFileNames;
+		};
+		/// get the unused arguments as pointers into argv (or to stray config file lines), valid as long as argv and the parser
+		const std::vector<const char*>& fGetUnusedArgs() const {
+			return lUnusedArgs;
+		};
 		const std::string& fGetProgName() const {
 			return lProgName;
 		}
 		static void fPrintEscapedString(std::ostream &aStream, const std::string& aString);
+		/// \brief keep aString until the current parser (see fGetInstance()) is destructed, equal strings are kept once
+		/// \details used for the values of const char* options, without a parser the strings are kept until the program ends
+		static const char* fInternString(const std::string& aString);
 		static void fReCaptureEscapedString(std::string& aDest, const std::string& aSource);
 	};
 
+/// parser for option sets that are parsed while the program runs, e.g. by many threads at once
+
+/// From its construction to its destruction a parserContext is the current context of the
+/// constructing thread: options constructed by that thread in the meantime belong to the context
+/// instead of the global option set, and parser::fGetInstance() returns the context.
+/// A context reads no config files and has none of the standard options like --help,
+/// errors are reported by throwing internal::parseError instead of calling exit().
+/// As with the global parser the options can be parsed only once, so a context and its
+/// options are made for each argument vector, e.g.
+/// \code
+/// void handleJob(const std::string& aCommandLine) {
+/// 	options::parserContext context;
+/// 	options::single<int> number(gJobOptions[0], 1);
+/// 	context.fParse(aCommandLine); // may throw options::internal::parseError
+/// 	...
+/// }
+/// \endcode
+/// Declaring the options via an optionDescriptor table keeps that cheap. Threads may use
+/// their own contexts at the same time. The options must not outlive their context.
+	class parserContext: public parser {
+	  protected:
+		parser* lPreviousContext;
+		std::ostringstream lErrorText;
+		std::vector<std::string> lArgs; ///< copy of the parsed words, the unused args point into these
+		/// context that reads the config files from aSearchPaths like the global parser
+		parserContext(const std::string& aDescription, const std::string& aTrailer, const std::vector<std::string>& aSearchPaths);
+		/// stop being the current context of this thread before being destructed
+		void fLeave();
+	  public:
+		parserContext(const std::string& aDescription = "", const std::string& aTrailer = "");
+		~parserContext() override;
+		parserContext(const parserContext&) = delete;
+		parserContext& operator=(const parserContext&) = delete;
+		/// parse argc/argv like parser::fParse(), with this context being the current one
+		const std::vector<std::string>& fParse(int argc, const char *argv[]);
+		const std::vector<std::string>& fParse(int argc, char *argv[]);
+		/// parse the words in aArgs, the first of which is the program name as in argv
+		const std::vector<std::string>& fParse(const std::vector<std::string>& aArgs);
+		/// split aCommandLine into words like a POSIX shell (quotes and backslashes, no expansions) and parse them
+		const std::vector<std::string>& fParse(const std::string& aCommandLine);
+		/// throw an internal::parseError with the error messages written so far
+		[[noreturn]] void fComplainAndLeave(bool aWithHelp = true) override;
+	};
+
+
+	/// closed interval [lLower, lUpper] of allowed values, several intervals can be added to the range of an option
+	template <typename T> class interval {
+	  public:
+		T lLower;
+		T lUpper;
+		interval(const T& aLower, const T& aUpper) :
+			lLower(aLower), lUpper(aUpper) {
+		};
+	};
 
 	namespace internal {
+		/// lookup of single allowed values, by binary search in the sorted values
+		template <typename T, bool hashable = std::is_integral<T>::value || std::is_same<T, std::string>::value> class rangeValueIndex {
+		  public:
+			void fAdd(const T& /*aValue*/) {};
+			bool fContains(const std::multiset<T>& aValues, const T& aValue) const {
+				auto it = aValues.lower_bound(aValue);
+				return it != aValues.end() && *it == aValue;
+			};
+		};
+		/// lookup of single allowed values by hash for types that have a std::hash
+		template <typename T> class rangeValueIndex<T, true> {
+		  protected:
+			std::unordered_set<T> lIndex;
+		  public:
+			void fAdd(const T& aValue) {
+				lIndex.insert(aValue);
+			};
+			bool fContains(const std::multiset<T>& /*aValues*/, const T& aValue) const {
+				return lIndex.count(aValue) != 0;
+			};
+		};
+
+		/// \brief allowed values of an option: single values and a set of closed intervals
+		/// \details For compatibility a range of exactly two single values and no intervals
+		/// is the interval between them.
+		template <typename T> class valueRange {
+		  protected:
+			std::multiset<T> lValues;
+			std::vector<interval<T>> lIntervals; ///< sorted and disjoint
+			rangeValueIndex<T> lIndex;
+			std::size_t lGeneration; ///< counts the changes of the range
+		  public:
+			valueRange():
+				lGeneration(0) {
+			};
+			bool fIsEmpty() const {
+				return lValues.empty() && lIntervals.empty();
+			};
+			std::size_t fGetGeneration() const {
+				return lGeneration;
+			};
+			void fAdd(const T& aValue) {
+				lValues.emplace(aValue);
+				lIndex.fAdd(aValue);
+				++lGeneration;
+			};
+			/// add an interval, overlapping intervals are merged
+			void fAdd(const interval<T>& aInterval) {
+				interval<T> added(aInterval);
+				if (added.lUpper < added.lLower) {
+					std::swap(added.lLower, added.lUpper);
+				}
+				auto it = std::lower_bound(lIntervals.begin(), lIntervals.end(), added, [](const interval<T>& aLeft, const interval<T>& aRight) {
+					return aLeft.lUpper < aRight.lLower;
+				});
+				auto last = it;
+				while (last != lIntervals.end() && !(added.lUpper < last->lLower)) {
+					if (last->lLower < added.lLower) {
+						added.lLower = last->lLower;
+					}
+					if (added.lUpper < last->lUpper) {
+						added.lUpper = last->lUpper;
+					}
+					++last;
+				}
+				it = lIntervals.erase(it, last);
+				lIntervals.insert(it, added);
+				++lGeneration;
+			};
+			bool fContains(const T& aValue) const {
+				if (lIntervals.empty() && lValues.size() == 2) {
+					return *(lValues.cbegin()) <= aValue && aValue <= *(lValues.crbegin());
+				}
+				auto it = std::upper_bound(lIntervals.begin(), lIntervals.end(), aValue, [](const T& aLeft, const interval<T>& aRight) {
+					return aLeft < aRight.lLower;
+				});
+				if (it != lIntervals.begin() && aValue <= (it - 1)->lUpper) {
+					return true;
+				}
+				return lIndex.fContains(lValues, aValue);
+			};
+			/// write the range in the format of the "# allowed range is" comment line, aPrinter writes single values
+			template <typename Printer> void fWrite(std::ostream& aStream, Printer aPrinter) const {
+				if (fIsEmpty()) {
+					return;
+				}
+				aStream << "# allowed range is";
+				if (lIntervals.empty() && lValues.size() == 2) {
+					aStream << " [";
+					aPrinter(aStream, *(lValues.cbegin()));
+					aStream << ",";
+					aPrinter(aStream, *(lValues.crbegin()));
+					aStream << "]\n";
+					return;
+				}
+				const char* separator = " ";
+				for (const auto& range : lIntervals) {
+					aStream << separator << "[";
+					aPrinter(aStream, range.lLower);
+					aStream << ",";
+					aPrinter(aStream, range.lUpper);
+					aStream << "]";
+					separator = " or ";
+				}
+				if (!lValues.empty()) {
+					aStream << (lIntervals.empty() ? ":" : " or one of:");
+					for (const auto& value : lValues) {
+						aStream << " ";
+						aPrinter(aStream, value);
+					}
+				}
+				aStream << "\n";
+			};
+			void fWrite(std::ostream& aStream) const {
+				fWrite(aStream, [](std::ostream & aOut, const T & aValue) {
+					using escapedIO::operator<<;
+					aOut << aValue;
+				});
+			};
+		};
+
 		template <typename T, bool forceRangeValueTypeString = false> class typed_base: public base {
 		  public:
 			typedef T valueType;
 			typedef typename std::conditional < std::is_same<T, const char *>::value || forceRangeValueTypeString, std::string, T >::type rangeValueType;
 			typedef typename std::conditional<forceRangeValueTypeString, std::string, T>::type compareValueType;
 		  protected:
-			std::multiset<rangeValueType> lRange;
+			valueRange<rangeValueType> lRange;
+
+			/// read one value for the range from aText
+			static bool fReadRangeValue(const std::string& aText, rangeValueType& aValue) {
+				std::stringstream buf(aText);
+				buf >> std::setbase(0);
+				using escapedIO::operator>>;
+				buf >> aValue;
+				return !buf.fail();
+			};
 		  public:
 
 			template <class ... Types> typed_base(Types ... args) :
@@ -519,14 +1410,15 @@ namespace options {
 			};
 			/// add a value to the range of allowed values
 			virtual void fAddToRange(rangeValueType aValue) {
-				lRange.emplace(aValue);
+				lRange.fAdd(aValue);
+			};
+			/// add an interval to the range of allowed values
+			virtual void fAddToRange(const interval<rangeValueType>& aInterval) {
+				lRange.fAdd(aInterval);
 			};
 			template <typename TT = std::string> typename std::enable_if < (!std::is_same<rangeValueType, std::string>::value) && std::is_same<TT, std::string>::value, void >::type fAddToRange(const TT& aString) {
-				std::stringstream buf(aString);
 				rangeValueType value;
-				buf >> std::setbase(0);
-				using escapedIO::operator>>;
-				buf >> value;
+				fReadRangeValue(aString, value);
 				fAddToRange(value);
 			};
 			/// add values from the iterator range [aBegin,aEnd) to the range of allowed values
@@ -539,51 +1431,45 @@ namespace options {
 			template <typename TT> void fAddToRange(const std::vector<TT>& aRange) {
 				fAddToRange(aRange.cbegin(), aRange.cend());
 			}
-			/// \details read a line from aStream and then add as many values as can be read from that line to the list of allowed values
+			/// \details read a line from aStream and then add as many values as can be read from that line to the list of allowed values,
+			/// intervals are given as [lower,upper]
 			void fAddToRangeFromStream(std::istream& aStream) override {
 				std::string buf;
 				std::getline(aStream, buf);
 				std::stringstream sbuf(buf);
-				while (!sbuf.eof()) {
-					rangeValueType value;
-					using escapedIO::operator>>;
-					sbuf >> std::setbase(0) >> value;
-					fAddToRange(value);
-				}
-			};
-			void  fWriteRange(std::ostream &aStream) const override {
-				using escapedIO::operator<<;
-				if (! lRange.empty()) {
-					aStream << "# allowed range is";
-					if (lRange.size() == 2) {
-						aStream << " [" << *(lRange.cbegin()) << "," << *(lRange.crbegin()) << "]\n";
+				while (!(sbuf >> std::ws).eof()) {
+					if (sbuf.peek() == '[') {
+						sbuf.get();
+						std::string text;
+						std::getline(sbuf, text, ']');
+						auto comma = text.find(',');
+						rangeValueType lower;
+						rangeValueType upper;
+						if (comma == std::string::npos ||
+						        !fReadRangeValue(text.substr(0, comma), lower) ||
+						        !fReadRangeValue(text.substr(comma + 1), upper)) {
+							break;
+						}
+						fAddToRange(interval<rangeValueType>(lower, upper));
 					} else {
-						aStream << ":";
-						for (const auto& it : lRange) {
-							aStream << " " << it;
+						rangeValueType value;
+						using escapedIO::operator>>;
+						sbuf >> std::setbase(0) >> value;
+						if (sbuf.fail()) {
+							break;
 						}
-						aStream << "\n";
+						fAddToRange(value);
 					}
 				}
 			};
+			void  fWriteRange(std::ostream &aStream) const override {
+				lRange.fWrite(aStream);
+			};
 			virtual void fCheckValueForRange(const compareValueType& aValue) const {
-				using escapedIO::operator<<;
-				if (lRange.empty()) {
+				if (lRange.fIsEmpty() || lRange.fContains(aValue)) {
 					return;
-				} else if (lRange.size() == 2) {
-					if (*(lRange.cbegin()) <= aValue && aValue <= *(lRange.crbegin())) {
-						return;
-					} else {
-						throw typedRangeError<compareValueType>(this, aValue);
-					}
-				} else {
-					for (const auto& it : lRange) {
-						if (it == aValue) {
-							return;
-						}
-					}
-					throw typedRangeError<compareValueType>(this, aValue);
 				}
+				throw typedRangeError<compareValueType>(this, aValue);
 			}
 		};
 	} // end of namespace internal
@@ -616,7 +1502,28 @@ namespace options {
 		single(char aShortName, const std::string& aLongName, const std::string& aExplanation) :
 			internal::typed_base<T>(aShortName, aLongName, aExplanation, 1) {
 		};
+		/// \brief construct an object of single<T> declared by aDescriptor, see optionDescriptor
+		single(const optionDescriptor& aDescriptor, T aDefault, const std::vector<T>& aRange = {}) :
+			deriveFromType(aDefault),
+			internal::typed_base<T>(aDescriptor, 1) {
+			if (!aRange.empty()) {
+				this->fAddToRange(aRange);
+			}
+		};
+		single(const optionDescriptor& aDescriptor) :
+			internal::typed_base<T>(aDescriptor, 1) {
+		};
 		single(const single&) = delete;
+	  protected:
+		base* fMakeStagingCopy() const override {
+			if (typeid(*this) != typeid(single)) {
+				return nullptr;
+			}
+			auto copy = new single(this->lShortName, this->lLongName.fGetString(), this->lExplanation.fGetString(), *this);
+			copy->lRange = this->lRange;
+			return copy;
+		};
+	  public:
 
 		T operator=(const T& aValue) {
 			T& thisAsReference(*this);
@@ -649,9 +1556,27 @@ namespace options {
 			}
 			this->fSetSource(aSource);
 		}
+		bool fConvertFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) override {
+			return fConvertDirectly(aBegin, aEnd, aSource, internal::hasDirectConversion<T>());
+		}
+		bool fIsDeferrable() const override {
+			return true;
+		}
 		const T &fGetValue() const {
 			return *this;
 		}
+	  protected:
+		bool fConvertDirectly(const char* /*aBegin*/, const char* /*aEnd*/, const internal::sourceItem& /*aSource*/, std::false_type) {
+			return false;
+		}
+		bool fConvertDirectly(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource, std::true_type) {
+			T& value(*this);
+			if (internal::fConvertNumber(aBegin, aEnd, value) == nullptr) {
+				throw internal::conversionError(this, std::string(aBegin, aEnd), typeid(T));
+			}
+			this->fSetSource(aSource);
+			return true;
+		}
 	};
 
 /// class specialisation for options of type bool
@@ -664,7 +1589,20 @@ namespace options {
 			base(aShortName, aLongName, aExplanation, 0),
 			lDefault(aDefault) {
 		}
+		single(const optionDescriptor& aDescriptor, bool aDefault = false) :
+			fundamental_wrapper(aDefault),
+			base(aDescriptor, 0),
+			lDefault(aDefault) {
+		}
 		single(const single&) = delete;
+	  protected:
+		base* fMakeStagingCopy() const override {
+			if (typeid(*this) != typeid(single)) {
+				return nullptr;
+			}
+			return new single(lShortName, lLongName.fGetString(), lExplanation.fGetString(), lValue);
+		};
+	  public:
 		bool operator=(const bool& aValue) {
 			lValue = aValue;
 			return lValue;
@@ -683,6 +1621,165 @@ namespace options {
 		}
 	};
 
+	namespace internal {
+		/// interface of options whose value may be changed while the program runs, see liveTunable
+		class liveTunableBase {
+		  public:
+			virtual ~liveTunableBase() = default;
+			/// set the value from aValue like from a config file line, including range check and the action of withAction
+			virtual void fRetune(const std::string& aValue, const sourceItem& aSource) = 0;
+		};
+
+		/// storage for liveTunable values that fit into a lock-free std::atomic, read with relaxed loads
+		template <typename T, bool fitsIntoAtomic = std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(std::uint64_t)> class liveValue {
+			std::atomic<T> lValue;
+		  public:
+			typedef T readType;
+			explicit liveValue(const T& aValue):
+				lValue(aValue) {
+			};
+			readType fLoad() const {
+				return lValue.load(std::memory_order_relaxed);
+			};
+			void fStore(const T& aValue) {
+				lValue.store(aValue, std::memory_order_relaxed);
+			};
+		};
+		/// \brief storage for other liveTunable values, readers copy the value an atomic pointer points to
+		/// \details Readers register in the slot of the parity of the epoch while they copy, as the readers of
+		/// cfgWatcher do. fStore() advances the epoch after switching the pointer and deletes the replaced
+		/// value once the readers of the previous epoch are gone, so only the current value is kept.
+		/// Calls of fStore() must be serialised.
+		template <typename T> class liveValue<T, false> {
+			std::atomic<const T*> lValue;
+			std::atomic<std::uint64_t> lEpoch;
+			mutable std::atomic<long> lReaders[2];
+		  public:
+			typedef T readType;
+			explicit liveValue(const T& aValue):
+				lValue(new T(aValue)),
+				lEpoch(0) {
+				lReaders[0].store(0);
+				lReaders[1].store(0);
+			};
+			~liveValue() {
+				delete lValue.load();
+			};
+			liveValue(const liveValue&) = delete;
+			liveValue& operator=(const liveValue&) = delete;
+			readType fLoad() const {
+				for (;;) {
+					auto epoch = lEpoch.load();
+					auto& readers = lReaders[epoch & 1];
+					readers.fetch_add(1);
+					if (lEpoch.load() == epoch) {
+						T value(*lValue.load());
+						readers.fetch_sub(1);
+						return value;
+					}
+					readers.fetch_sub(1); // a value was stored meanwhile
+				}
+			};
+			void fStore(const T& aValue) {
+				auto previous = lValue.exchange(new T(aValue));
+				auto epoch = lEpoch.fetch_add(1);
+				while (lReaders[epoch & 1].load() != 0) {
+					std::this_thread::yield();
+				}
+				delete previous;
+			};
+		};
+	} // end of namespace internal
+
+/// option whose value may be changed while the program runs, reads take no locks
+
+/// Other than single<T> the option is not the value itself, which is read via fGet() from any thread.
+/// Fundamental types and std::chrono::durations are kept in a std::atomic and read with relaxed loads,
+/// other types like std::string via an atomic pointer, fGet() returns a copy of them and a replaced
+/// value is deleted as soon as no reader copies it any more. New values are set via fRetune() from strings, which checks
+/// the range before the value becomes visible and calls the action of a withAction<liveTunable<T>>,
+/// or via fSet(). Setting the value is serialised, but the source of the value is not meant to be
+/// read from other threads while that happens.
+	template <typename T> class liveTunable: public internal::typed_base<T>, public internal::liveTunableBase {
+	  protected:
+		internal::liveValue<T> lValue;
+		std::mutex lWriteMutex;
+	  public:
+		typedef typename internal::liveValue<T>::readType readType;
+		/// \brief construct an object of liveTunable<T>, the parameters are the same as for single<T>
+		liveTunable(char aShortName, const std::string& aLongName, const std::string& aExplanation, T aDefault, const std::vector<T>& aRange = {}) :
+			internal::typed_base<T>(aShortName, aLongName, aExplanation, 1),
+			lValue(aDefault) {
+			if (!aRange.empty()) {
+				this->fAddToRange(aRange);
+			}
+		};
+		/// \brief construct an object of liveTunable<T> declared by aDescriptor, see optionDescriptor
+		liveTunable(const optionDescriptor& aDescriptor, T aDefault, const std::vector<T>& aRange = {}) :
+			internal::typed_base<T>(aDescriptor, 1),
+			lValue(aDefault) {
+			if (!aRange.empty()) {
+				this->fAddToRange(aRange);
+			}
+		};
+		liveTunable(const liveTunable&) = delete;
+	  protected:
+		base* fMakeStagingCopy() const override {
+			if (typeid(*this) != typeid(liveTunable)) {
+				return nullptr;
+			}
+			auto copy = new liveTunable(this->lShortName, this->lLongName.fGetString(), this->lExplanation.fGetString(), fGet());
+			copy->lRange = this->lRange;
+			return copy;
+		};
+	  public:
+		readType fGet() const {
+			return lValue.fLoad();
+		};
+		operator readType() const {
+			return fGet();
+		};
+		/// set the value after checking its range, throws internal::rangeError if it is out of range
+		void fSet(const T& aValue) {
+			std::lock_guard<std::mutex> lock(lWriteMutex);
+			this->fCheckValueForRange(aValue);
+			lValue.fStore(aValue);
+		};
+		void fRetune(const std::string& aValue, const internal::sourceItem& aSource) override {
+			std::lock_guard<std::mutex> lock(lWriteMutex);
+			this->fSetMeFromString(aValue.data(), aValue.data() + aValue.size(), aSource);
+			this->fCheckRange();
+		};
+
+		void fAddDefaultFromStream(std::istream& aStream) override {
+			using escapedIO::operator>>;
+			T value(fGet());
+			aStream >> std::setbase(0) >> value;
+			lValue.fStore(value);
+		}
+		void fWriteValue(std::ostream& aStream) const override {
+			using escapedIO::operator<<;
+			aStream << fGet();
+		}
+		void fCheckRange() const override {
+			this->fCheckValueForRange(fGet());
+		}
+		void fSetMe(std::istream& aStream, const internal::sourceItem& aSource) override {
+			using escapedIO::operator>>;
+			T value(fGet());
+			aStream >> std::setbase(0) >> std::noskipws >> value;
+			if (aStream.fail()) {
+				std::string arg;
+				aStream.clear();
+				aStream >> arg;
+				throw internal::conversionError(this, arg, typeid(T));
+			}
+			this->fCheckValueForRange(value); // readers must never see values out of range
+			lValue.fStore(value);
+			this->fSetSource(aSource);
+		}
+	};
+
 	namespace escapedIO {
 		std::istream& operator>> (std::istream &aStream, const char*& aCstring);
 	} // end of namespace escapedIO
@@ -691,27 +1788,120 @@ namespace options {
 	/// special namespace for classes and functions that are meant for internal use only
 
 	namespace internal {
+		/// \brief remembers up to which state the values of a container option were checked against the range
+		/// \details Values are checked one by one as they are added, so fCheckRange() needs to check all
+		/// values again only when the range changed or the container was modified by other means.
+		class rangeCheckState {
+		  protected:
+			mutable std::size_t lCheckedGeneration;
+			mutable std::size_t lCheckedSize;
+		  public:
+			rangeCheckState():
+				lCheckedGeneration(std::numeric_limits<std::size_t>::max()),
+				lCheckedSize(0) {
+			};
+			bool fIsChecked(std::size_t aRangeGeneration, std::size_t aSize) const {
+				return aRangeGeneration == lCheckedGeneration && aSize == lCheckedSize;
+			};
+			void fSetChecked(std::size_t aRangeGeneration, std::size_t aSize) const {
+				lCheckedGeneration = aRangeGeneration;
+				lCheckedSize = aSize;
+			};
+			/// a value that was checked on its own was added, the container grew from aSizeBefore to aSizeAfter
+			void fValueAdded(std::size_t aRangeGeneration, std::size_t aSizeBefore, std::size_t aSizeAfter) {
+				if (fIsChecked(aRangeGeneration, aSizeBefore)) {
+					lCheckedSize = aSizeAfter;
+				}
+			};
+		};
+
+		/// \brief run length encoded sources of the values of container and map options
+		/// \details The values are numbered in the order they were added. Consecutive values from the
+		/// same file whose line numbers grow by a constant step, like the lines of a config file or
+		/// repeated arguments on the command line, share one run. When keeping the sources is switched
+		/// off all values count as unset and only the number of added values is kept.
+		class sourceRuns {
+		  protected:
+			class run {
+			  public:
+				std::size_t lFirstIndex;
+				const sourceFile* lFile;
+				int lFirstLineNumber;
+				int lLineStep;
+			};
+			std::vector<run> lRuns;
+			std::size_t lSize;
+			bool lKeepSources;
+		  public:
+			sourceRuns():
+				lSize(0),
+				lKeepSources(true) {
+			};
+			/// add the source of the next value
+			void fAdd(const sourceItem& aSource);
+			/// source of the value with index aIndex, unset if there is none
+			sourceItem fGet(std::size_t aIndex) const;
+			/// number of values added, whether their sources were kept or not
+			std::size_t fSize() const {
+				return lSize;
+			};
+			bool fGetKeepSources() const {
+				return lKeepSources;
+			};
+			/// switching off forgets the sources recorded so far
+			void fSetKeepSources(bool aKeepSources);
+		};
+
 /// This class is an intermediate helper class for options that
 /// are map-based. It is not to be used directly.
 		template <typename T> class baseForMap: public typed_base<T> {
 		  protected:
-			std::map<const T*, const internal::sourceItem> lSources;
+			sourceRuns lSources;
+			/// locations of the values whose sources are kept, in the order they were set
+			std::vector<const T*> lValueLocations;
+			rangeCheckState lRangeCheck;
+			/// index into lSources of the value set as lValueLocations[aLocationIndex]
+			std::size_t fGetSourceIndex(std::size_t aLocationIndex) const {
+				return lSources.fSize() - lValueLocations.size() + aLocationIndex;
+			};
 		  public:
 			baseForMap(char aShortName, std::string  aLongName, std::string  aExplanation, short aNargs) :
 				typed_base<T>(aShortName, aLongName, aExplanation, aNargs) {};
+			baseForMap(const optionDescriptor& aDescriptor, short aNargs) :
+				typed_base<T>(aDescriptor, aNargs) {};
 			void fAddSource(const T* aValueLocation, const internal::sourceItem& aSource) {
-				lSources.insert(std::make_pair(aValueLocation, aSource));
+				if (lSources.fGetKeepSources()) {
+					lValueLocations.push_back(aValueLocation);
+				}
+				lSources.fAdd(aSource);
 			};
+			/// source of the value at aValueLocation, searches linearly so fWriteCfgLines() uses fGetSourceMap()
 			const internal::sourceItem fGetSource(const T* aValueLocation) const {
-				auto it = lSources.find(aValueLocation);
-				if (it != lSources.end()) {
-					return it->second;
-				} else {
-					return internal::sourceItem();
+				for (auto i = lValueLocations.size(); i > 0; i--) {
+					if (lValueLocations[i - 1] == aValueLocation) {
+						return lSources.fGet(fGetSourceIndex(i - 1));
+					}
+				}
+				return internal::sourceItem();
+			};
+			/// map from value locations to the index of their latest source
+			std::unordered_map<const T*, std::size_t> fGetSourceMap() const {
+				std::unordered_map<const T*, std::size_t> sourceMap(lValueLocations.size());
+				for (std::size_t i = 0; i < lValueLocations.size(); i++) {
+					sourceMap[lValueLocations[i]] = fGetSourceIndex(i);
+				}
+				return sourceMap;
+			};
+			/// keep the sources of the values for the '# set from' lines in written config files,
+			/// switch off for very large maps to save memory
+			void fSetKeepSources(bool aKeepSources) {
+				lSources.fSetKeepSources(aKeepSources);
+				if (!aKeepSources) {
+					std::vector<const T*>().swap(lValueLocations);
 				}
 			};
 			bool fIsSet() const override {
-				return ! lSources.empty();
+				return lSources.fSize() > 0;
 			};
 			bool fIsContainer() const override {
 				return true;
@@ -740,13 +1930,32 @@ namespace options {
 				this->insert(this->end(), defaultValue);
 			}
 		}
+		map(const optionDescriptor& aDescriptor, std::initializer_list<typename Container::value_type> aDefault = {}) :
+			internal::baseForMap<T>(aDescriptor, 1) {
+			for (const auto& defaultValue : aDefault) {
+				this->insert(this->end(), defaultValue);
+			}
+		}
 		map(const map&) = delete;
+	  protected:
+		base* fMakeStagingCopy() const override {
+			if (typeid(*this) != typeid(map)) {
+				return nullptr;
+			}
+			auto copy = new map(this->lShortName, this->lLongName.fGetString(), this->lExplanation.fGetString());
+			static_cast<Container&>(*copy) = *this;
+			copy->lRange = this->lRange;
+			return copy;
+		};
+	  public:
 		void fWriteCfgLines(std::ostream& aStream, const char *aPrefix) const override {
 			if (this->empty()) {
 				aStream << aPrefix << this->lLongName << "=key" << parser::fGetInstance()->fGetSecondaryAssignment() << "value\n";
 			}
+			auto sourceMap = this->fGetSourceMap();
 			for (const auto& it : *this) {
-				auto source = this->fGetSource(&(it.second));
+				auto sourceIndex = sourceMap.find(&(it.second));
+				auto source = sourceIndex == sourceMap.end() ? internal::sourceItem() : this->lSources.fGet(sourceIndex->second);
 				aStream << (source.fIsUnset() ? aPrefix : "") << this->lLongName << "=" << it.first <<  parser::fGetInstance()->fGetSecondaryAssignment();
 				{
 					using escapedIO::operator<<;
@@ -807,19 +2016,62 @@ namespace options {
 			if (conversionStream.fail()) {
 				throw internal::conversionError(this, name, typeid(key));
 			}
+			this->fCheckValueForRange(value);
+			auto sizeBefore = this->size();
 			auto result = (*this).insertOrUpdate(std::make_pair(key, value));
+			this->lRangeCheck.fValueAdded(this->lRange.fGetGeneration(), sizeBefore, this->size());
 			this->fAddSource(&(result->second), aSource);
 		};
+		bool fConvertFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) override {
+			return fConvertDirectly(aBegin, aEnd, aSource, std::integral_constant < bool, internal::hasDirectConversion<T>::value &&
+			                        std::is_same<typename std::remove_const<typename Container::value_type::first_type>::type, std::string>::value > ());
+		}
 
 		void fCheckRange() const override {
+			if (this->lRangeCheck.fIsChecked(this->lRange.fGetGeneration(), this->size())) {
+				return;
+			}
 			for (const auto& pair : *this) {
 				this->fCheckValueForRange(pair.second);
 			}
+			this->lRangeCheck.fSetChecked(this->lRange.fGetGeneration(), this->size());
 		};
 
 		typename std::add_rvalue_reference<std::add_const<Container>>::type fGetValue() const  {
 			return *static_cast<typename std::add_pointer<std::add_const<Container>>::type>(this);
 		}
+	  protected:
+		bool fConvertDirectly(const char* /*aBegin*/, const char* /*aEnd*/, const internal::sourceItem& /*aSource*/, std::false_type) {
+			return false;
+		}
+		/// same as fSetMe() for string keys and values with a direct conversion, only the value skips the stream
+		bool fConvertDirectly(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource, std::true_type) {
+			auto separator = std::find(aBegin, aEnd, parser::fGetInstance()->fGetSecondaryAssignment());
+			if (separator == aEnd) { // not found, complain!
+				throw internal::optionError(this, internal::conCat(" a '", parser::fGetInstance()->fGetSecondaryAssignment(), "' separator is required, none given"));
+			}
+			T value;
+			auto valueBegin = internal::fSkipWhiteSpace(separator + 1, aEnd);
+			if (internal::fConvertNumber(valueBegin, aEnd, value) == nullptr) {
+				throw internal::conversionError(this, std::string(valueBegin, aEnd), typeid(value));
+			}
+			std::string key;
+			{ // the key may be quoted or contain spaces, so it is read like in fSetMe()
+				internal::charRangeBuf buf(aBegin, separator);
+				std::istream conversionStream(&buf);
+				using escapedIO::operator>>;
+				conversionStream >> key;
+				if (conversionStream.fail()) {
+					throw internal::conversionError(this, std::string(aBegin, separator), typeid(key));
+				}
+			}
+			this->fCheckValueForRange(value);
+			auto sizeBefore = this->size();
+			auto result = (*this).insertOrUpdate(std::make_pair(std::move(key), value));
+			this->lRangeCheck.fValueAdded(this->lRange.fGetGeneration(), sizeBefore, this->size());
+			this->fAddSource(&(result->second), aSource);
+			return true;
+		}
 	};
 
 	/// \namespace options::internal
@@ -828,12 +2080,21 @@ namespace options {
 /// are container-based. It is not to be used directly.
 		template <typename T> class baseForContainer: public typed_base<T> {
 		  protected:
-			std::vector<internal::sourceItem> lSources;
+			/// sources of the values set after construction, which are the last ones in the container
+			sourceRuns lSources;
+			rangeCheckState lRangeCheck;
 		  public:
 			baseForContainer(char aShortName, std::string  aLongName, std::string  aExplanation, short aNargs) :
 				typed_base<T>(aShortName, aLongName, aExplanation, aNargs) {};
+			baseForContainer(const optionDescriptor& aDescriptor, short aNargs) :
+				typed_base<T>(aDescriptor, aNargs) {};
+			/// keep the sources of the values for the '# set from' lines in written config files,
+			/// switch off for very large containers to save memory
+			void fSetKeepSources(bool aKeepSources) {
+				lSources.fSetKeepSources(aKeepSources);
+			};
 			bool fIsSet() const override {
-				return ! lSources.empty();
+				return lSources.fSize() > 0;
 			};
 			bool fIsContainer() const override {
 				return true;
@@ -858,20 +2119,40 @@ namespace options {
 				this->push_back(defaultValue);
 			}
 		}
+		container(const optionDescriptor& aDescriptor, std::initializer_list<typename Container::value_type> aDefault = {}) :
+			internal::baseForContainer<T>(aDescriptor, 1) {
+			for (const auto& defaultValue : aDefault) {
+				this->push_back(defaultValue);
+			}
+		}
 		container(const container&) = delete;
+	  protected:
+		base* fMakeStagingCopy() const override {
+			if (typeid(*this) != typeid(container)) {
+				return nullptr;
+			}
+			auto copy = new container(this->lShortName, this->lLongName.fGetString(), this->lExplanation.fGetString());
+			static_cast<Container&>(*copy) = *this;
+			copy->lRange = this->lRange;
+			return copy;
+		};
+	  public:
 		void fWriteCfgLines(std::ostream& aStream, const char *aPrefix) const override {
 			if (this->empty()) {
 				aStream << aPrefix << this->lLongName << "=value\n";
 			}
-			auto it2 = this->lSources.begin();
-			for (auto it = this->begin(); it != this->end(); ++it, ++it2) {
-				aStream << (it2->fIsUnset() ? aPrefix : "") << this->lLongName << "=";
+			// the constructor defaults come first and have no recorded sources
+			std::size_t unrecorded = this->size() > this->lSources.fSize() ? this->size() - this->lSources.fSize() : 0;
+			std::size_t index = 0;
+			for (auto it = this->begin(); it != this->end(); ++it, ++index) {
+				auto source = index < unrecorded ? internal::sourceItem() : this->lSources.fGet(index - unrecorded);
+				aStream << (source.fIsUnset() ? aPrefix : "") << this->lLongName << "=";
 				{
 					using escapedIO::operator<<;
 					aStream << *it << "\n";
 				}
-				if (!it2->fIsUnset()) {
-					aStream << "# set from " << *it2 << "\n";
+				if (!source.fIsUnset()) {
+					aStream << "# set from " << source << "\n";
 				}
 			}
 		}
@@ -902,18 +2183,43 @@ namespace options {
 				aStream >> arg;
 				throw internal::conversionError(this, arg, typeid(value));
 			}
+			this->fCheckValueForRange(value);
+			auto sizeBefore = this->size();
 			this->push_back(value);
-			this->lSources.push_back(aSource);
+			this->lRangeCheck.fValueAdded(this->lRange.fGetGeneration(), sizeBefore, this->size());
+			this->lSources.fAdd(aSource);
+		}
+		bool fConvertFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) override {
+			return fConvertDirectly(aBegin, aEnd, aSource, internal::hasDirectConversion<T>());
 		}
 
 		void fCheckRange() const override {
+			if (this->lRangeCheck.fIsChecked(this->lRange.fGetGeneration(), this->size())) {
+				return;
+			}
 			for (const auto& value : *this) {
 				this->fCheckValueForRange(value);
 			}
+			this->lRangeCheck.fSetChecked(this->lRange.fGetGeneration(), this->size());
 		};
 
-
-
+	  protected:
+		bool fConvertDirectly(const char* /*aBegin*/, const char* /*aEnd*/, const internal::sourceItem& /*aSource*/, std::false_type) {
+			return false;
+		}
+		bool fConvertDirectly(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource, std::true_type) {
+			T value;
+			auto valueBegin = internal::fSkipWhiteSpace(aBegin, aEnd);
+			if (internal::fConvertNumber(valueBegin, aEnd, value) == nullptr) {
+				throw internal::conversionError(this, std::string(valueBegin, aEnd), typeid(value));
+			}
+			this->fCheckValueForRange(value);
+			auto sizeBefore = this->size();
+			this->push_back(value);
+			this->lRangeCheck.fValueAdded(this->lRange.fGetGeneration(), sizeBefore, this->size());
+			this->lSources.fAdd(aSource);
+			return true;
+		}
 	};
 
 
@@ -954,6 +2260,9 @@ namespace options {
 			T(args...),
 			action(aAction) {
 		}
+		bool fIsDeferrable() const override {
+			return false;
+		}
 		void fSetMe(std::istream& aStream, const internal::sourceItem& aSource) override {
 			T::fSetMe(aStream, aSource);
 			this->fCheckRange();
@@ -964,6 +2273,14 @@ namespace options {
 			this->fCheckRange();
 			action(*this);
 		}
+		bool fConvertFromString(const char* aBegin, const char* aEnd, const internal::sourceItem& aSource) override {
+			if (!T::fConvertFromString(aBegin, aEnd, aSource)) {
+				return false; // the action will be called from our fSetMe()
+			}
+			this->fCheckRange();
+			action(*this);
+			return true;
+		}
 	};
 
 } // end of namespace options
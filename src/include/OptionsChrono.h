@@ -7,16 +7,73 @@
 
 #include <iostream>
 #include <chrono>
+#include <ctime>
 #include <type_traits>
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace options {
 /// template specialisation for options that are std::chrono::time_point<std::chrono::system_clock>
 	namespace internal {
-		std::chrono::duration<double> parseNumberAndUnit(std::stringstream& aStream, int* aMonths = nullptr, int* aYears = nullptr);
+		/// parse a sequence of number-unit pairs into whole seconds and nanoseconds using exact integer arithmetic,
+		/// if given set the years and months separately; throws std::runtime_error on bad input or overflow
+		void fParseDuration(const char* aBegin, const char* aEnd, long long& aSeconds, long long& aNanoSeconds, int* aMonths = nullptr, int* aYears = nullptr);
+		/// parse a sequence of number-unit pairs into floating point seconds, for durations with a floating point representation
+		void fParseDuration(const char* aBegin, const char* aEnd, double& aSeconds, int* aMonths = nullptr, int* aYears = nullptr);
+		class timeZone;
+		/// the "now" against which relative time points like "tomorrow" or "3 days after now" are parsed.
+		/// The time and the local zone are pinned at construction, so all strings parsed against
+		/// one reference are consistent with each other.
+		class timePointReference {
+		  protected:
+			std::chrono::system_clock::time_point lNow;
+			std::tm lLocalNow;
+			const timeZone* lLocalZone;
+		  public:
+			timePointReference();
+			explicit timePointReference(std::chrono::system_clock::time_point aNow);
+			const std::chrono::system_clock::time_point& fGetNow() const {
+				return lNow;
+			};
+			/// broken down local time of now
+			const std::tm& fGetLocalNow() const {
+				return lLocalNow;
+			};
+			const timeZone& fGetLocalZone() const {
+				return *lLocalZone;
+			};
+		};
+		/// the reference shared by all time points converted while the current parser parses, nullptr when it doesn't
+		const timePointReference* fGetParseTimePointReference();
+		/// parse against the reference of the running parse, so all values of one parse agree on "now", or else against now
 		std::chrono::system_clock::time_point fParseTimePointString(const std::string& aString);
+		std::chrono::system_clock::time_point fParseTimePointString(const std::string& aString, const timePointReference& aReference);
+		/// parse many time point strings against one pinned reference, e.g. long lists of dates
+		void fParseTimePointStrings(const std::vector<std::string>& aStrings, std::vector<std::chrono::system_clock::time_point>& aTimePoints, const timePointReference& aReference = timePointReference());
+
+		/// integral representations are set exactly to 1 ns resolution within the range of long long seconds
+		template <class Rep, class Period> void fConvertDurationString(std::chrono::duration<Rep, Period> &aDuration, const std::string& aString, int* aMonths, int* aYears, std::false_type /*isFloatingPoint*/) {
+			typedef typename std::remove_reference<decltype(aDuration)>::type durationType;
+			long long seconds;
+			long long nanoSeconds;
+			fParseDuration(aString.data(), aString.data() + aString.size(), seconds, nanoSeconds, aMonths, aYears);
+			auto approximate = std::chrono::duration<double>(seconds) + std::chrono::duration<double, std::nano>(nanoSeconds);
+			if (approximate > std::chrono::duration<double>(durationType::max()) ||
+			        approximate < std::chrono::duration<double>(durationType::min())) {
+				throw std::runtime_error("duration '" + aString + "' out of range");
+			}
+			aDuration = std::chrono::duration_cast<durationType>(std::chrono::seconds(seconds)) +
+			            std::chrono::duration_cast<durationType>(std::chrono::nanoseconds(nanoSeconds));
+		}
+		/// floating point representations keep values below 1 ns and beyond the range of long long seconds
+		template <class Rep, class Period> void fConvertDurationString(std::chrono::duration<Rep, Period> &aDuration, const std::string& aString, int* aMonths, int* aYears, std::true_type /*isFloatingPoint*/) {
+			double seconds;
+			fParseDuration(aString.data(), aString.data() + aString.size(), seconds, aMonths, aYears);
+			aDuration = std::chrono::duration_cast<std::chrono::duration<Rep, Period>>(std::chrono::duration<double>(seconds));
+		}
 
 		/// parse a string into a std::chrono::duration, if given set the years and months separately
 		template <class Rep, class Period> void parseDurationString(std::chrono::duration<Rep, Period> &aDuration, const std::string& aString, int* aMonths = nullptr, int* aYears = nullptr) {
@@ -24,18 +81,16 @@ namespace options {
 			if (between != std::string::npos) {
 				auto andpos = aString.find("and");
 				if (andpos != std::string::npos) {
-					auto t0 = fParseTimePointString(aString.substr(between + 8, andpos - 1 - (between + 8) ));
-					auto t1 = fParseTimePointString(aString.substr(andpos + 4));
+					auto parseReference = fGetParseTimePointReference();
+					const timePointReference& reference = parseReference != nullptr ? *parseReference : timePointReference();
+					auto t0 = fParseTimePointString(aString.substr(between + 8, andpos - 1 - (between + 8) ), reference);
+					auto t1 = fParseTimePointString(aString.substr(andpos + 4), reference);
 					aDuration = std::chrono::duration_cast<typename std::remove_reference<decltype(aDuration)>::type>(t1 - t0);
 				} else {
 					throw std::runtime_error("duration with 'between' without and");
 				}
 			} else {
-				std::stringstream sbuf(aString);
-				aDuration = aDuration.zero();
-				while (!sbuf.eof()) {
-					aDuration += std::chrono::duration_cast<typename std::remove_reference<decltype(aDuration)>::type>(parseNumberAndUnit(sbuf, aMonths, aYears));
-				}
+				fConvertDurationString(aDuration, aString, aMonths, aYears, typename std::is_floating_point<Rep>::type());
 			}
 		};
 	} // end of namespace internal
@@ -72,8 +127,6 @@ namespace options {
 		public valuePrinter<std::chrono::system_clock::time_point> {
 	  public:
 		typedef rangeValueType valueType;
-	  protected:
-		std::vector<valueType> lRange;
 
 	  public:
 		static void fDefaultValuePrinter(std::ostream& aStream, const valueType& aValue);
@@ -89,6 +142,9 @@ namespace options {
 		void fCheckRange() const override {
 			this->fCheckValueForRange(*this);
 		}
+		bool fIsDeferrable() const override {
+			return true;
+		}
 	};
 
 
@@ -104,8 +160,6 @@ namespace options {
 		        public originalStringKeeper {
 	  public:
 		typedef std::chrono::duration<Rep, Period> valueType; // why does the one in typed_base not work?
-	  protected:
-		std::vector<valueType> lRange;
 
 	  public:
 		static void fDefaultValuePrinter(std::ostream& aStream, const valueType& aValue) {
@@ -146,6 +200,9 @@ namespace options {
 		void fCheckRange() const override {
 			this->fCheckValueForRange(*this);
 		}
+		bool fIsDeferrable() const override {
+			return true;
+		}
 	};
 
 
@@ -0,0 +1,70 @@
+/*
+   Option parser  C++(11) library for parsing command line options
+    Copyright (C) 2016  Juergen Hannappel
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __OptionsControlSocket_H__
+#define __OptionsControlSocket_H__
+
+#include "Options.h"
+
+namespace options {
+/// serves a UNIX domain socket to inspect and retune the options of a running program
+
+/// The socket is served by a background thread from construction to destruction, which
+/// should happen after parsing and before the parser and the options go away.
+/// Clients, e.g. socat, are served one after the other, sending one command per line.
+/// A client that neither sends a command nor takes its reply within the idle timeout
+/// is disconnected, so it can not keep the others waiting.
+/// Each reply ends with a line that is either "ok" or "error: " followed by the message:
+/// - get <name>: the value of the option as it would be written to a config file
+/// - set <name>=<value>: set the value like from a config file, including the range check,
+///   the source is then "controlSocket". Only liveTunable options can be set.
+/// - dump: all options in config file syntax, those never set commented out
+/// - source <name>: where the value was set from, e.g. "commandLine:3"
+///
+/// Values of options other than liveTunable are read without synchronisation, which is
+/// fine as long as the program does not change them after parsing.
+	class controlSocket {
+	  protected:
+		const parser& lParser;
+		const std::string lPath;
+		int lListenFd;
+		int lStopPipe[2];
+		int lSetCount; ///< number of successful sets, the line number of the source of values set via the socket
+		std::chrono::milliseconds lIdleTimeout;
+		std::thread lThread;
+
+		void fRun();
+		void fServe(int aFd);
+		void fHandle(const std::string& aCommand, std::ostream& aReply);
+		base* fFindOption(const std::string& aName) const;
+	  public:
+		/// create the socket at aPath, replacing a stale one, accessible for the owner only
+
+		/// The socket is bound inside a private directory next to aPath and then
+		/// renamed into place, so its permissions are set without touching the umask.
+		controlSocket(const parser& aParser, const std::string& aPath,
+		              std::chrono::milliseconds aIdleTimeout = std::chrono::seconds(10));
+		~controlSocket();
+		controlSocket(const controlSocket&) = delete;
+		controlSocket& operator=(const controlSocket&) = delete;
+		const std::string& fGetPath() const {
+			return lPath;
+		};
+	};
+} // end of namespace options
+
+#endif
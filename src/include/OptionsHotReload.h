@@ -0,0 +1,131 @@
+/*
+   Option parser  C++(11) library for parsing command line options
+    Copyright (C) 2016  Juergen Hannappel
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __OptionsHotReload_H__
+#define __OptionsHotReload_H__
+
+#include "Options.h"
+#include <atomic>
+#include <mutex>
+
+namespace options {
+	namespace internal {
+		/// a complete set of option copies, living in their own parserContext
+		class cfgSnapshot {
+		  public:
+			parserContext* lContext;
+			std::vector<const base*> lOriginals; ///< the global options, in the order of their copies
+			std::vector<base*> lCopies;
+			cfgSnapshot();
+			~cfgSnapshot();
+			cfgSnapshot(const cfgSnapshot&) = delete;
+			cfgSnapshot& operator=(const cfgSnapshot&) = delete;
+		};
+	} // end of namespace internal
+
+/// follows the config files of the parser and publishes their new values as atomic snapshots
+
+/// Enabled by parser::fSetCfgFilesAreWatched() before parsing. The watcher then copies the
+/// default values of all options when parsing starts and, once parsing is done, uses inotify
+/// to follow all config files that were read or looked for, including the nested ones.
+/// When one of them changes, the command line is parsed again, together with the config files,
+/// into copies of the options in a staging parserContext, so the range checks and the
+/// require/forbid rules apply as usual. Only if all that succeeds the copies are published as
+/// the new snapshot and the event fd is signalled, otherwise the error is kept for
+/// fGetLastError() and the previous snapshot stays valid.
+///
+/// The global options themselves keep the values of the startup, the values of the current
+/// snapshot are read via a reader, which takes no locks:
+/// \code
+/// {
+/// 	options::cfgWatcher::reader config(*parser.fGetCfgWatcher());
+/// 	auto n = config.fGet(gNumber); // the same snapshot for all fGet() calls of config
+/// }
+/// \endcode
+/// A reader blocks the release of its snapshot, so it should be kept only briefly.
+/// single, container, map and liveTunable options of exactly these types are copied. Other options,
+/// e.g. the chrono and regex ones, positionals and withAction, whose actions must not run again,
+/// can not be reloaded: fGet() returns their value of the startup, and if a config file sets them
+/// on a reload their names are reported by fGetLastError() while the other values are published.
+/// The config files are read, not memory mapped, on a reload, as they may be truncated meanwhile.
+	class cfgWatcher {
+		friend class parser;
+	  public:
+		/// lock-free access to the snapshot that is current when the reader is constructed
+		class reader {
+		  protected:
+			const cfgWatcher& lWatcher;
+			unsigned int lReaderSlot;
+			const internal::cfgSnapshot* lSnapshot;
+			const base* fGetCopy(const base& aOption) const;
+		  public:
+			reader(const cfgWatcher& aWatcher);
+			~reader();
+			reader(const reader&) = delete;
+			reader& operator=(const reader&) = delete;
+			/// the value of aOption in the snapshot, aOption itself if no snapshot was published yet
+			template <typename T> const T& fGet(const T& aOption) const {
+				auto copy = dynamic_cast<const T*>(fGetCopy(aOption));
+				return copy != nullptr ? *copy : aOption;
+			};
+		};
+	  protected:
+		const parser& lParser;
+		std::vector<std::string> lArgs; ///< the command line of the global parse
+		internal::cfgSnapshot* lDefaults;
+		std::atomic<const internal::cfgSnapshot*> lCurrent;
+		std::atomic<std::uint64_t> lEpoch; ///< readers register in the slot of the parity of the epoch
+		mutable std::atomic<long> lReaders[2];
+		std::atomic<std::uint64_t> lGeneration;
+		int lEventFd;
+		int lStopFd;
+		int lInotifyFd;
+		std::mutex lWatchMutex; ///< guards lWatchedDirectories and lWatchedFiles, fReload() may run in any thread
+		std::map<int, std::set<std::string>> lWatchedDirectories; ///< the base names of the files per watch descriptor
+		std::set<std::string> lWatchedFiles;
+		std::mutex lReloadMutex; ///< there is only one writer of the snapshots at a time, readers don't lock
+		std::thread lThread;
+		mutable std::mutex lLastErrorMutex;
+		std::string lLastError;
+
+		void fRememberDefaults(int argc, const char *argv[]);
+		void fStart(const std::vector<std::string>& aFileNames);
+		void fWatch(const std::vector<std::string>& aFileNames);
+		void fRun();
+		internal::cfgSnapshot* fMakeCopies(const internal::cfgSnapshot& aTemplate, const std::vector<std::string>& aSearchPaths) const;
+		void fPublish(const internal::cfgSnapshot* aSnapshot);
+	  public:
+		cfgWatcher(const parser& aParser);
+		~cfgWatcher();
+		cfgWatcher(const cfgWatcher&) = delete;
+		cfgWatcher& operator=(const cfgWatcher&) = delete;
+		/// parse again now, as if a config file had changed, true if a new snapshot was published
+		bool fReload();
+		/// file descriptor to be used with poll/epoll, readable after a new snapshot was published
+		int fGetEventFd() const {
+			return lEventFd;
+		};
+		/// number of snapshots published so far
+		std::uint64_t fGetGeneration() const {
+			return lGeneration.load();
+		};
+		/// the error messages of the last failed reload, or the options whose new values were ignored, empty if all went well
+		std::string fGetLastError() const;
+	};
+} // end of namespace options
+
+#endif
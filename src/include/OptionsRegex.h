@@ -29,6 +29,9 @@ namespace options {
 		void fCheckRange() const override {
 			return;
 		}
+		bool fIsDeferrable() const override {
+			return true;
+		}
 		void fAddDefaultFromStream(std::istream& aStream) override {
 			std::getline(aStream, lOriginalString);
 			assign(lOriginalString);
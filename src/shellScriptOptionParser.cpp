@@ -19,13 +19,36 @@
 #include <limits>
 #include <ratio>
 #include <set>
+#include <fstream>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <errno.h>
 #include <unistd.h>
 
-template <typename T> class arrayOption: public  options::container<T> {
+/// interface of the options with many values, which can list them one by one for the batch output formats
+class valueLister {
+  public:
+	typedef std::function<void(const std::string& aKey, const std::string& aValue)> valueConsumer;
+	virtual ~valueLister() = default;
+	/// call aConsumer for each value with its key (empty if not a map) and its text as fWriteValue() writes it
+	virtual void fListValues(const valueConsumer& aConsumer) const = 0;
+};
+
+template <typename T> class arrayOption: public  options::container<T>, public valueLister {
   public:
 	template <class ... Types> arrayOption(Types ... args) :
 		options::container<T>(args...) {
 	};
+	void fListValues(const valueConsumer& aConsumer) const override {
+		for (const auto& item : *this) {
+			std::ostringstream value;
+			using options::escapedIO::operator<<;
+			value << item;
+			aConsumer("", value.str());
+		}
+	};
 	void fWriteValue(std::ostream& aStream) const override {
 		aStream << "(";
 		for (const auto& item : *this) {
@@ -37,11 +60,19 @@ template <typename T> class arrayOption: public  options::container<T> {
 	};
 };
 
-template <typename T> class mapOption: public  options::map<T> {
+template <typename T> class mapOption: public  options::map<T>, public valueLister {
   public:
 	template <class ... Types> mapOption(Types ... args) :
 		options::map<T>(args...) {
 	};
+	void fListValues(const valueConsumer& aConsumer) const override {
+		for (const auto& item : *this) {
+			std::ostringstream value;
+			using options::escapedIO::operator<<;
+			value << item.second;
+			aConsumer(item.first, value.str());
+		}
+	};
 	void fWriteValue(std::ostream& aStream) const override {
 		aStream << "; unset " << this->fGetLongName() << "; declare -A " << this->fGetLongName() << "=(";
 		for (const auto& item : *this) {
@@ -53,11 +84,19 @@ template <typename T> class mapOption: public  options::map<T> {
 	};
 };
 
-template <typename T> class listOption: public  options::container<T> {
+template <typename T> class listOption: public  options::container<T>, public valueLister {
   public:
 	template <class ... Types> listOption(Types ... args) :
 		options::container<T>(args...) {
 	};
+	void fListValues(const valueConsumer& aConsumer) const override {
+		for (const auto& item : *this) {
+			std::ostringstream value;
+			using options::escapedIO::operator<<;
+			value << item;
+			aConsumer("", value.str());
+		}
+	};
 	void fWriteValue(std::ostream& aStream) const override {
 		aStream << "\"";
 		bool start = true;
@@ -80,48 +119,721 @@ enum typeModifierType {
 	kAsList
 };
 
-template <typename T> options::base* fOptionFromStream(std::istream &aStream, T defaultValue, typeModifierType aAsWhat) {
-	char shortName;
-	std::string longName;
-	std::string description;
-
-	aStream >> shortName;
-	aStream >> longName;
-	aStream.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
-	std::getline(aStream, description);
-
-	if (shortName == '-') {
-		shortName = '\0';
-	}
+template <typename T> options::base* fMakeOption(char aShortName, const std::string& aLongName, const std::string& aDescription, T defaultValue, typeModifierType aAsWhat) {
 	switch (aAsWhat) {
 		case kSimple:
-			return new options::single<T>(shortName, longName, description, defaultValue);
+			return new options::single<T>(aShortName, aLongName, aDescription, defaultValue);
 		case kAsArray:
-			return new arrayOption<T>(shortName, longName, description);
+			return new arrayOption<T>(aShortName, aLongName, aDescription);
 		case kAsMap:
-			return new mapOption<T>(shortName, longName, description);
+			return new mapOption<T>(aShortName, aLongName, aDescription);
 		case kAsList:
-			return new listOption<T>(shortName, longName, description);
+			return new listOption<T>(aShortName, aLongName, aDescription);
 	}
 	return nullptr;
 }
 
+/// the type names fMakeOption() knows, to tell intact cache entries
+static const std::set<std::string> gOptionTypes = {"string", "int", "uint", "size", "bool", "seconds", "milliseconds", "microseconds", "date", "idate"};
 
-int main(int argc, const char *argv[]) {
-	std::string description;
-	if (isatty(0) != 1) {
-		while (std::cin.good()) {
-			std::string line;
-			if (std::cin.eof()) {
-				break;
+/// create an option of the type named by aType, nullptr if there is no such type
+options::base* fMakeOption(const std::string& aType, char aShortName, const std::string& aLongName, const std::string& aDescription, typeModifierType aAsWhat) {
+	if (aType == "string") {
+		return fMakeOption<std::string>(aShortName, aLongName, aDescription, "", aAsWhat);
+	} else if (aType == "int") {
+		return fMakeOption<int>(aShortName, aLongName, aDescription, 0, aAsWhat);
+	} else if (aType == "uint") {
+		return fMakeOption<unsigned int>(aShortName, aLongName, aDescription, 0, aAsWhat);
+	} else if (aType == "size") {
+		return fMakeOption<options::postFixedNumber<size_t>>(aShortName, aLongName, aDescription, 0, aAsWhat);
+	} else if (aType == "bool") {
+		return fMakeOption<bool>(aShortName, aLongName, aDescription, false, aAsWhat);
+	} else if (aType == "seconds") {
+		return fMakeOption<std::chrono::duration<long long>>(aShortName, aLongName, aDescription, std::chrono::seconds(1), aAsWhat);
+	} else if (aType == "milliseconds") {
+		return fMakeOption<std::chrono::duration<long long, std::milli>>(aShortName, aLongName, aDescription, std::chrono::seconds(1), aAsWhat);
+	} else if (aType == "microseconds") {
+		return fMakeOption<std::chrono::duration<long long, std::micro>>(aShortName, aLongName, aDescription, std::chrono::seconds(1), aAsWhat);
+	} else if (aType == "date") {
+		return fMakeOption<std::chrono::system_clock::time_point>(aShortName, aLongName, aDescription, std::chrono::system_clock::now(), aAsWhat);
+	} else if (aType == "idate") {
+		auto option = fMakeOption<std::chrono::system_clock::time_point>(aShortName, aLongName, aDescription, std::chrono::system_clock::now(), aAsWhat);
+		auto opt = dynamic_cast<options::valuePrinter<std::chrono::system_clock::time_point>*>(option);
+		if (opt) {
+			opt->fSetValuePrinter([](std::ostream & aStream, const std::chrono::system_clock::time_point & aValue)->void {aStream << std::chrono::duration_cast<std::chrono::duration<long>>(aValue.time_since_epoch()).count();});
+		}
+		return option;
+	}
+	return nullptr;
+}
+
+using options::internal::fAppendBinary;
+using options::internal::fExtractBinary;
+
+/// \brief the options part of a spec, i.e. what follows 'options:' on standard input, in compiled form
+/// \details Range and default lines are kept as the text they consumed when the spec was read,
+/// as the meaning of values like 'yesterday' depends on when they are converted.
+class compiledSpec {
+  public:
+	/// magic string at the start of spec cache files, to be changed with the format
+	static constexpr const char* gMagic = "shellScriptOptionParserSpec1\n";
+	class optionEntry {
+	  public:
+		std::string lType;
+		typeModifierType lAsWhat;
+		char lShortName;
+		std::string lLongName;
+		std::string lDescription;
+		bool lExported;
+		int lPositional;
+		std::string lValueKinds; ///< 'r' for each range and 'd' for each default line, in order
+		std::vector<std::string> lValueTexts;
+	};
+	std::vector<optionEntry> lOptions;
+	std::string lMinusMinusSpecialTreatment;
+	std::vector<std::string> lSearchPath;
+	unsigned int lMinUnusedParameters;
+	unsigned int lMaxUnusedParameters;
+	std::string lTrailer;
+
+	compiledSpec():
+		lSearchPath({"/etc/", "~/.", "~/.config/", "./."}),
+		lMinUnusedParameters(0),
+		lMaxUnusedParameters(std::numeric_limits<unsigned int>::max()) {
+	};
+	bool fCompile(std::istream& aSpec, std::vector<options::base*>& aOptions);
+	void fInstantiate(std::vector<options::base*>& aOptions) const;
+	bool fRead(const std::string& aFileName, const std::string& aSpecText);
+	void fWrite(const std::string& aFileName, const std::string& aSpecText) const;
+};
+
+/// read the options part of aSpec, creating the options in aOptions on the fly, false on errors
+bool compiledSpec::fCompile(std::istream& aSpec, std::vector<options::base*>& aOptions) {
+	std::string keyWord;
+	bool exportNextOption = false;
+	typeModifierType nextOptionAsWhat = kSimple;
+	int nextOptionPositional = 0;
+	while (aSpec.good()) {
+		aSpec >> keyWord;
+		if (aSpec.eof()) {
+			break;
+		}
+		if (keyWord == "range" || keyWord == "default") {
+			if (aOptions.empty()) {
+				std::cerr << "'" << keyWord << "' before any option, giving up" << std::endl;
+				return false;
+			}
+			auto begin = aSpec.tellg();
+			if (keyWord == "range") {
+				aOptions.back()->fAddToRangeFromStream(aSpec);
+			} else {
+				aOptions.back()->fAddDefaultFromStream(aSpec);
+			}
+			auto end = aSpec.tellg();
+			aSpec.clear();
+			aSpec.seekg(begin);
+			std::string text(end == decltype(end)(-1) ? std::numeric_limits<std::size_t>::max() : static_cast<std::size_t>(end - begin), '\0');
+			aSpec.read(&text[0], text.size());
+			text.resize(aSpec.gcount());
+			if (end == decltype(end)(-1)) { // the line ended the input, leave the stream as the option did
+				aSpec.setstate(std::ios::eofbit);
+			} else {
+				aSpec.clear();
+			}
+			lOptions.back().lValueKinds += keyWord[0];
+			lOptions.back().lValueTexts.push_back(text);
+		} else if (keyWord == "export") {
+			exportNextOption = true;
+			continue;
+		} else if (keyWord == "array") {
+			nextOptionAsWhat = kAsArray;
+			continue;
+		} else if (keyWord == "map") {
+			nextOptionAsWhat = kAsMap;
+			continue;
+		} else if (keyWord == "list") {
+			nextOptionAsWhat = kAsList;
+			continue;
+		} else if (keyWord == "positional") {
+			aSpec >> nextOptionPositional;
+			continue;
+		} else if (keyWord == "minusMinusSpecialTreatment") {
+			aSpec >> lMinusMinusSpecialTreatment;
+			continue;
+		} else if (keyWord == "minUnusedParameters") {
+			aSpec >> lMinUnusedParameters;
+			continue;
+		} else if (keyWord == "maxUnusedParameters") {
+			aSpec >> lMaxUnusedParameters;
+			continue;
+		} else if (keyWord == "noPath") {
+			lSearchPath.clear();
+			continue;
+		} else if (keyWord == "path") {
+			std::string buffer;
+			using options::escapedIO::operator>>;
+			aSpec >> buffer;
+			lSearchPath.push_back(buffer);
+		} else if (keyWord == "trailer:") {
+			break;
+		} else {
+			optionEntry entry;
+			entry.lType = keyWord;
+			entry.lAsWhat = nextOptionAsWhat;
+			entry.lExported = false;
+			entry.lPositional = 0;
+			aSpec >> entry.lShortName;
+			aSpec >> entry.lLongName;
+			aSpec.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
+			std::getline(aSpec, entry.lDescription);
+			if (entry.lShortName == '-') {
+				entry.lShortName = '\0';
+			}
+			auto option = fMakeOption(entry.lType, entry.lShortName, entry.lLongName, entry.lDescription, entry.lAsWhat);
+			if (option == nullptr) {
+				std::cerr << "illegal option type '" << keyWord << "', giving up" << std::endl;
+				return false;
+			}
+			aOptions.push_back(option);
+			lOptions.push_back(entry);
+		}
+		if (! aOptions.empty()) {
+			if (nextOptionPositional != 0) {
+				options::internal::positional_base(nextOptionPositional, aOptions.back());
+				lOptions.back().lPositional = nextOptionPositional;
+			}
+			if (exportNextOption) {
+				lOptions.back().lExported = true;
+			}
+		}
+		exportNextOption = false;
+		nextOptionAsWhat = kSimple;
+		nextOptionPositional = 0;
+	}
+	return true;
+}
+
+/// create the options as fCompile() did, replaying their range and default lines
+void compiledSpec::fInstantiate(std::vector<options::base*>& aOptions) const {
+	for (const auto& entry : lOptions) {
+		auto option = fMakeOption(entry.lType, entry.lShortName, entry.lLongName, entry.lDescription, entry.lAsWhat);
+		for (std::size_t i = 0; i < entry.lValueTexts.size(); i++) {
+			std::istringstream text(entry.lValueTexts[i]);
+			if (entry.lValueKinds[i] == 'r') {
+				option->fAddToRangeFromStream(text);
+			} else {
+				option->fAddDefaultFromStream(text);
+			}
+		}
+		if (entry.lPositional != 0) {
+			options::internal::positional_base(entry.lPositional, option);
+		}
+		aOptions.push_back(option);
+	}
+}
+
+/// read the cache file aFileName, false if it is not there, damaged or made from another spec than aSpecText
+bool compiledSpec::fRead(const std::string& aFileName, const std::string& aSpecText) {
+	options::internal::fileContent cacheFile;
+	if (cacheFile.fRead(aFileName) != 0) {
+		return false;
+	}
+	auto position = cacheFile.fBegin();
+	auto end = cacheFile.fEnd();
+	auto magicLength = strlen(gMagic);
+	std::uint64_t specLength;
+	if (static_cast<std::size_t>(end - position) < magicLength || memcmp(position, gMagic, magicLength) != 0) {
+		return false;
+	}
+	position += magicLength;
+	if (!fExtractBinary(position, end, specLength) || specLength != aSpecText.size()
+	        || static_cast<std::size_t>(end - position) < specLength || memcmp(position, aSpecText.data(), specLength) != 0) {
+		return false;
+	}
+	position += specLength;
+	std::uint32_t nOptions, nPaths;
+	if (!fExtractBinary(position, end, nOptions)) {
+		return false;
+	}
+	for (std::uint32_t i = 0; i < nOptions; i++) {
+		optionEntry entry;
+		std::uint8_t asWhat, exported;
+		std::int32_t positional;
+		if (!fExtractBinary(position, end, entry.lType)
+		        || !fExtractBinary(position, end, asWhat)
+		        || !fExtractBinary(position, end, entry.lShortName)
+		        || !fExtractBinary(position, end, entry.lLongName)
+		        || !fExtractBinary(position, end, entry.lDescription)
+		        || !fExtractBinary(position, end, exported)
+		        || !fExtractBinary(position, end, positional)
+		        || !fExtractBinary(position, end, entry.lValueKinds)) {
+			return false;
+		}
+		if (gOptionTypes.count(entry.lType) == 0 || asWhat > kAsList) { // would make no option
+			return false;
+		}
+		entry.lAsWhat = static_cast<typeModifierType>(asWhat);
+		entry.lExported = exported != 0;
+		entry.lPositional = positional;
+		entry.lValueTexts.resize(entry.lValueKinds.size());
+		for (auto& text : entry.lValueTexts) {
+			if (!fExtractBinary(position, end, text)) {
+				return false;
+			}
+		}
+		lOptions.push_back(std::move(entry));
+	}
+	if (!fExtractBinary(position, end, lMinusMinusSpecialTreatment)
+	        || !fExtractBinary(position, end, lMinUnusedParameters)
+	        || !fExtractBinary(position, end, lMaxUnusedParameters)
+	        || !fExtractBinary(position, end, nPaths)) {
+		return false;
+	}
+	lSearchPath.resize(nPaths);
+	for (auto& path : lSearchPath) {
+		if (!fExtractBinary(position, end, path)) {
+			return false;
+		}
+	}
+	return fExtractBinary(position, end, lTrailer) && position == end;
+}
+
+/// write the cache file aFileName via a temporary file, so concurrent invocations see either none or all of it
+void compiledSpec::fWrite(const std::string& aFileName, const std::string& aSpecText) const {
+	std::string buffer(gMagic);
+	fAppendBinary(buffer, static_cast<std::uint64_t>(aSpecText.size()));
+	buffer += aSpecText;
+	fAppendBinary(buffer, static_cast<std::uint32_t>(lOptions.size()));
+	for (const auto& entry : lOptions) {
+		fAppendBinary(buffer, entry.lType);
+		fAppendBinary(buffer, static_cast<std::uint8_t>(entry.lAsWhat));
+		fAppendBinary(buffer, entry.lShortName);
+		fAppendBinary(buffer, entry.lLongName);
+		fAppendBinary(buffer, entry.lDescription);
+		fAppendBinary(buffer, static_cast<std::uint8_t>(entry.lExported));
+		fAppendBinary(buffer, static_cast<std::int32_t>(entry.lPositional));
+		fAppendBinary(buffer, entry.lValueKinds);
+		for (const auto& text : entry.lValueTexts) {
+			fAppendBinary(buffer, text);
+		}
+	}
+	fAppendBinary(buffer, lMinusMinusSpecialTreatment);
+	fAppendBinary(buffer, lMinUnusedParameters);
+	fAppendBinary(buffer, lMaxUnusedParameters);
+	fAppendBinary(buffer, static_cast<std::uint32_t>(lSearchPath.size()));
+	for (const auto& path : lSearchPath) {
+		fAppendBinary(buffer, path);
+	}
+	fAppendBinary(buffer, lTrailer);
+	options::internal::fWriteFileAtomically(aFileName, buffer);
+}
+
+/// \brief name of the spec cache file for aSpecText, empty if caching is disabled
+/// \details the directory is $SHELL_SCRIPT_OPTION_PARSER_CACHE, if set, else shellScriptOptionParser in
+/// $XDG_CACHE_HOME or ~/.cache. It is created if needed, setting the variable to an empty value disables the cache.
+std::string fSpecCacheFileName(const std::string& aSpecText) {
+	std::string directory;
+	auto cacheDirectory = getenv("SHELL_SCRIPT_OPTION_PARSER_CACHE");
+	if (cacheDirectory != nullptr) {
+		directory = cacheDirectory;
+	} else {
+		auto xdgCacheHome = getenv("XDG_CACHE_HOME");
+		auto home = getenv("HOME");
+		if (xdgCacheHome != nullptr && *xdgCacheHome != '\0') {
+			directory = xdgCacheHome;
+		} else if (home != nullptr) {
+			directory = home;
+			directory += "/.cache";
+			mkdir(directory.c_str(), 0700);
+		}
+		if (!directory.empty()) {
+			directory += "/shellScriptOptionParser";
+		}
+	}
+	if (directory.empty()) {
+		return directory;
+	}
+	mkdir(directory.c_str(), 0700);
+	std::uint64_t hash = 14695981039346656037ULL; // FNV-1a, the cache file also holds the spec to rule out collisions
+	for (auto c : aSpecText) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+	}
+	std::ostringstream fileName;
+	fileName << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return fileName.str();
+}
+
+
+
+/// read the options part of aSpec, or if possible take it from the cache file aCacheFileName, false on errors
+bool fLoadSpec(std::istream& aSpec, const std::string& aSpecText, const std::string& aCacheFileName, compiledSpec& aCompiled, std::vector<options::base*>& aOptions) {
+	if (!aCacheFileName.empty() && aCompiled.fRead(aCacheFileName, aSpecText)) {
+		aCompiled.fInstantiate(aOptions);
+		return true;
+	}
+	aCompiled = compiledSpec();
+	if (!aCompiled.fCompile(aSpec, aOptions)) {
+		return false;
+	}
+	while (aSpec.good()) {
+		std::string line;
+		if (aSpec.eof()) {
+			break;
+		}
+		std::getline(aSpec, line);
+		aCompiled.lTrailer += line;
+		aCompiled.lTrailer += "\n";
+	}
+	if (!aCacheFileName.empty()) {
+		aCompiled.fWrite(aCacheFileName, aSpecText);
+	}
+	return true;
+}
+
+/// print the shell commands that set the variables of aOptions and the positional parameters to aUnusedOptions
+void fPrintShellCode(std::ostream& aStream, const std::vector<options::base*>& aOptions, const compiledSpec& aCompiled,
+                     const std::vector<std::string>& aUnusedOptions, const std::vector<std::string>& aStuffAfterMinusMinus) {
+	for (std::size_t i = 0; i < aOptions.size(); i++) {
+		if (aCompiled.lOptions[i].lExported) {
+			aStream << "export ";
+		}
+		aStream << aOptions[i]->fGetLongName() << "=";
+		aOptions[i]->fWriteValue(aStream);
+		aStream << "\n";
+	}
+	aStream << "shift $#\n";
+	if (aUnusedOptions.empty() == false) {
+		aStream << "set --";
+		for (auto & unusedOption : aUnusedOptions) {
+			aStream << " " << unusedOption;
+		}
+		aStream << "\n";
+	}
+	if (aStuffAfterMinusMinus.empty() == false) {
+		aStream << aCompiled.lMinusMinusSpecialTreatment << "=\"";
+		for (auto it =  aStuffAfterMinusMinus.begin(); it != aStuffAfterMinusMinus.end(); ++it) {
+			if (it != aStuffAfterMinusMinus.begin()) {
+				aStream << " ";
+			}
+			aStream << *it;
+		}
+		aStream << "\"\n";
+	}
+}
+
+/// parse the command line of the script, argv[1] being its name, and print the shell commands that set the variables
+int fParseAndPrint(const std::vector<options::base*>& aOptions, const compiledSpec& aCompiled, const std::string& aDescription,
+                   const std::string& aCfgCacheFileName, int argc, const char *argv[]) {
+	const auto& trailer = aCompiled.lTrailer;
+	const auto& searchPath = aCompiled.lSearchPath;
+	const auto& minusMinusSpecialTreatment = aCompiled.lMinusMinusSpecialTreatment;
+	auto minUnusedParameters = aCompiled.lMinUnusedParameters;
+	auto maxUnusedParameters = aCompiled.lMaxUnusedParameters;
+
+	options::parser parser(aDescription, trailer, searchPath);
+	parser.fSetMessageStream(&std::cerr);
+	parser.fSetHelpReturnValue(1);
+	parser.fSetExecutableName(argv[1]);
+	if (! minusMinusSpecialTreatment.empty()) {
+		parser.fSetMinusMinusStartsExtraList();
+	}
+	if (! aCfgCacheFileName.empty()) {
+		parser.fSetCfgCacheFile(aCfgCacheFileName);
+	}
+
+	auto unusedOptions = parser.fParse(argc - 1, argv + 1);
+
+	if (unusedOptions.size() < minUnusedParameters ||
+	        unusedOptions.size() > maxUnusedParameters) {
+		std::cerr << "illegal number of non-option parameters " << unusedOptions.size() << ", must be between " << minUnusedParameters << " and " << maxUnusedParameters << std::endl;
+		parser.fHelp();
+		return (1);
+	}
+
+	fPrintShellCode(std::cout, aOptions, aCompiled, unusedOptions, parser.fGetStuffAfterMinusMinus());
+	return 0;
+}
+
+/// \brief answer requests on standard input until it ends, see the usage text for the protocol
+/// \details Each request is parsed in a child process that runs fParseAndPrint() as a single invocation would,
+/// so help output, errors and exit() behave the same. Only the fork is left of the cost of an invocation,
+/// the config files are kept in a config cache beside the spec cache and are read again only if they changed.
+int fServe(const compiledSpec& aCompiled, const std::string& aDescription, const std::string& aCacheFileName, const char* aArgv0, const char* aScriptName) {
+	auto cfgCacheFileName = aCacheFileName.empty() ? aCacheFileName : aCacheFileName + ".cfg";
+	std::string word;
+	while (std::getline(std::cin, word, '\0')) {
+		char* countEnd;
+		errno = 0;
+		auto nWords = strtoul(word.c_str(), &countEnd, 10);
+		if (word.empty() || !isdigit(static_cast<unsigned char>(word[0])) || *countEnd != '\0' || errno != 0) {
+			// without a valid count the following words can't be told apart, so this is the last reply
+			std::cerr << "illegal number of arguments '" << word << "' in request" << std::endl;
+			std::cout << "false\n" << '\0';
+			std::cout.flush();
+			return 1;
+		}
+		std::vector<std::string> words;
+		while (words.size() < nWords && std::getline(std::cin, word, '\0')) {
+			words.push_back(word);
+		}
+		if (words.size() < nWords) {
+			std::cerr << "incomplete request at end of input" << std::endl;
+			return 1;
+		}
+		std::vector<const char*> argv({aArgv0, aScriptName});
+		for (const auto& w : words) {
+			argv.push_back(w.c_str());
+		}
+		argv.push_back(nullptr);
+
+		std::cout.flush();
+		std::cerr.flush();
+		auto child = fork();
+		if (child < 0) {
+			std::cerr << "can't fork: " << strerror(errno) << std::endl;
+			return 1;
+		} else if (child == 0) {
+			std::vector<options::base*> options;
+			{
+				options::parser throwAwayInstance("tAI1", "", {});
+				aCompiled.fInstantiate(options);
 			}
-			std::getline(std::cin, line);
-			if (line.compare("options:") == 0) {
+			auto result = fParseAndPrint(options, aCompiled, aDescription, cfgCacheFileName, static_cast<int>(argv.size() - 1), argv.data());
+			std::cout.flush();
+			exit(result);
+		}
+		int status = 0;
+		pid_t waited;
+		while ((waited = waitpid(child, &status, 0)) < 0 && errno == EINTR) {
+		}
+		if (waited < 0) {
+			std::cerr << "can't wait for request parser: " << strerror(errno) << std::endl;
+		}
+		if (waited < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			std::cout << "false\n";
+		}
+		std::cout << '\0';
+		std::cout.flush();
+	}
+	return 0;
+}
+
+enum batchFormatType {
+	kShellCode,
+	kJson,
+	kNulPairs
+};
+
+/// parserContext that reads the config files of the search path like the global parser
+class batchContext: public options::parserContext {
+  public:
+	batchContext(const compiledSpec& aCompiled):
+		options::parserContext("", aCompiled.lTrailer, aCompiled.lSearchPath) {
+		if (! aCompiled.lMinusMinusSpecialTreatment.empty()) {
+			fSetMinusMinusStartsExtraList();
+		}
+	};
+};
+
+void fWriteJsonString(std::ostream& aStream, const std::string& aString) {
+	aStream << '"';
+	for (auto c : aString) {
+		switch (c) {
+			case '"':
+				aStream << "\\\"";
+				break;
+			case '\\':
+				aStream << "\\\\";
 				break;
+			case '\n':
+				aStream << "\\n";
+				break;
+			case '\t':
+				aStream << "\\t";
+				break;
+			case '\r':
+				aStream << "\\r";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < ' ') {
+					aStream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned int>(c) << std::setfill(' ') << std::dec;
+				} else {
+					aStream << c;
+				}
+		}
+	}
+	aStream << '"';
+}
+
+/// write the values of aOptions in aFormat, the values of the other formats are plain text without shell escapes
+void fWriteBatchResult(std::ostream& aStream, batchFormatType aFormat, std::size_t aRecordNumber,
+                       const std::vector<options::base*>& aOptions, const compiledSpec& aCompiled,
+                       const std::vector<std::string>& aUnusedOptions, const std::vector<std::string>& aStuffAfterMinusMinus) {
+	if (aFormat == kShellCode) {
+		fPrintShellCode(aStream, aOptions, aCompiled, aUnusedOptions, aStuffAfterMinusMinus);
+		aStream << '\0';
+		return;
+	}
+	auto plain = [](const std::string & aEscaped) {
+		std::istringstream escaped(aEscaped);
+		std::string value;
+		using options::escapedIO::operator>>;
+		escaped >> value;
+		return value;
+	};
+	auto writeList = [&aStream, aFormat](const std::string & aName, const std::vector<std::string>& aValues) {
+		if (aFormat == kNulPairs) {
+			for (const auto& value : aValues) {
+				aStream << aName << '\0' << value << '\0';
+			}
+			return;
+		}
+		aStream << ",";
+		fWriteJsonString(aStream, aName);
+		aStream << ":[";
+		for (std::size_t i = 0; i < aValues.size(); i++) {
+			aStream << (i == 0 ? "" : ",");
+			fWriteJsonString(aStream, aValues[i]);
+		}
+		aStream << "]";
+	};
+	if (aFormat == kJson) {
+		aStream << "{\"record\":" << aRecordNumber << ",\"values\":{";
+	}
+	for (std::size_t i = 0; i < aOptions.size(); i++) {
+		const auto& name = aOptions[i]->fGetLongName();
+		auto lister = dynamic_cast<const valueLister*>(aOptions[i]);
+		if (aFormat == kNulPairs) {
+			if (lister == nullptr) {
+				std::ostringstream value;
+				aOptions[i]->fWriteValue(value);
+				aStream << name << '\0' << plain(value.str()) << '\0';
+			} else {
+				lister->fListValues([&aStream, &name, &plain](const std::string & aKey, const std::string & aValue) {
+					aStream << name;
+					if (!aKey.empty()) {
+						aStream << '[' << aKey << ']';
+					}
+					aStream << '\0' << plain(aValue) << '\0';
+				});
+			}
+			continue;
+		}
+		aStream << (i == 0 ? "" : ",");
+		fWriteJsonString(aStream, name);
+		aStream << ":";
+		if (lister == nullptr) {
+			std::ostringstream value;
+			aOptions[i]->fWriteValue(value);
+			fWriteJsonString(aStream, plain(value.str()));
+		} else {
+			auto isMap = aCompiled.lOptions[i].lAsWhat == kAsMap;
+			bool firstValue = true;
+			aStream << (isMap ? "{" : "[");
+			lister->fListValues([&aStream, &firstValue, &plain](const std::string & aKey, const std::string & aValue) {
+				aStream << (firstValue ? "" : ",");
+				firstValue = false;
+				if (!aKey.empty()) {
+					fWriteJsonString(aStream, aKey);
+					aStream << ":";
+				}
+				fWriteJsonString(aStream, plain(aValue));
+			});
+			aStream << (isMap ? "}" : "]");
+		}
+	}
+	if (aFormat == kJson) {
+		aStream << "}";
+	}
+	writeList(aFormat == kJson ? "arguments" : "@", aUnusedOptions);
+	if (!aCompiled.lMinusMinusSpecialTreatment.empty()) {
+		writeList(aFormat == kJson ? "afterMinusMinus" : aCompiled.lMinusMinusSpecialTreatment, aStuffAfterMinusMinus);
+	}
+	if (aFormat == kJson) {
+		aStream << "}\n";
+	} else {
+		aStream << '\0';
+	}
+}
+
+/// write the error aMessage for record aRecordNumber in aFormat
+void fWriteBatchError(std::ostream& aStream, batchFormatType aFormat, std::size_t aRecordNumber, const std::string& aMessage) {
+	switch (aFormat) {
+		case kShellCode: {
+			std::istringstream lines(aMessage);
+			std::string line;
+			while (std::getline(lines, line)) {
+				aStream << "# " << line << "\n";
+			}
+			aStream << "false\n" << '\0';
+		}
+		break;
+		case kJson:
+			aStream << "{\"record\":" << aRecordNumber << ",\"error\":";
+			fWriteJsonString(aStream, aMessage);
+			aStream << "}\n";
+			break;
+		case kNulPairs:
+			aStream << "!" << '\0' << aMessage << '\0' << '\0';
+			break;
+	}
+}
+
+/// \brief parse each record of aRecords against the options of aCompiled, writing one result per record
+/// \details A record holds the words of a command line, the first being the program name, quoted like in a shell.
+/// Records are separated by aSeparator. Each record is parsed in its own batchContext, so the options
+/// start with their defaults and errors just end the record. Returns 1 if any record was not accepted.
+int fRunBatch(std::istream& aRecords, char aSeparator, batchFormatType aFormat, const compiledSpec& aCompiled) {
+	int result = 0;
+	std::string record;
+	for (std::size_t recordNumber = 1; std::getline(aRecords, record, aSeparator); recordNumber++) {
+		batchContext context(aCompiled);
+		std::vector<options::base*> options;
+		try {
+			aCompiled.fInstantiate(options);
+			const auto& unusedOptions = context.fParse(record);
+			if (unusedOptions.size() < aCompiled.lMinUnusedParameters ||
+			        unusedOptions.size() > aCompiled.lMaxUnusedParameters) {
+				throw options::internal::parseError(options::internal::conCat("illegal number of non-option parameters ", unusedOptions.size(),
+				                                    ", must be between ", aCompiled.lMinUnusedParameters, " and ", aCompiled.lMaxUnusedParameters));
 			}
-			description += line;
-			description += "\n";
+			fWriteBatchResult(std::cout, aFormat, recordNumber, options, aCompiled, unusedOptions, context.fGetStuffAfterMinusMinus());
+		} catch (const std::exception& e) {
+			fWriteBatchError(std::cout, aFormat, recordNumber, e.what());
+			result = 1;
+		}
+		for (auto option : options) {
+			delete option;
+		}
+	}
+	return result;
+}
+
+
+int main(int argc, const char *argv[]) {
+	bool coprocess = argc > 2 && strcmp(argv[1], "--coprocess") == 0;
+	bool batch = argc > 3 && (strcmp(argv[1], "--batch") == 0 || strcmp(argv[1], "--batch0") == 0);
+	std::string specText;
+	if (coprocess) { // the requests follow the spec on standard input
+		std::getline(std::cin, specText, '\0');
+	} else if (isatty(0) != 1) {
+		std::ostringstream buffer;
+		buffer << std::cin.rdbuf();
+		specText = buffer.str();
+	}
+	std::istringstream spec(specText);
+	std::string description;
+	while (spec.good()) {
+		std::string line;
+		if (spec.eof()) {
+			break;
 		}
+		std::getline(spec, line);
+		if (line.compare("options:") == 0) {
+			break;
+		}
+		description += line;
+		description += "\n";
 	}
 	if (description.empty() || description == "\n") {
 		std::cout << argv[0] << ": shell script option parser.\n"
@@ -162,6 +874,7 @@ int main(int argc, const char *argv[]) {
 		          "\tif the next line starts with 'range' the values following are added\n"
 		          "\tto the allowed value range of the option, many range lines may follow!\n"
 		          "\tif only two are given they denote a true range in the closed interval\n"
+		          "\tintervals may also be given as [lower,upper], e.g. 'range [1,8] [16,64]'\n"
 		          "\tif the next line starts with 'default' a default value\n"
 		          "\t (the rest of line) is set\n"
 		          "\tThe keyword 'minusMinusSpecialTreatment' will put the parameters\n"
@@ -170,161 +883,78 @@ int main(int argc, const char *argv[]) {
 		          "\tThe keyword 'path' adds the (escaped) rest of the line\n"
 		          "\tto the search path for config files\n"
 		          "\tThe keyword 'minUnusedParameters' sets the min number of params\n"
-		          "\tThe keyword 'maxUnusedParameters' sets the max number of params\n";
+		          "\tThe keyword 'maxUnusedParameters' sets the max number of params\n"
+		          "The options are kept in compiled form in the directory\n"
+		          "\t$SHELL_SCRIPT_OPTION_PARSER_CACHE, by default shellScriptOptionParser\n"
+		          "\tin $XDG_CACHE_HOME or ~/.cache, set it empty to disable the cache\n"
+		          "For scripts that parse many command lines one process can serve them all:\n"
+		          "coproc OPTS { shellScriptOptionParser --coprocess \"$0\"; }\n"
+		          "\tfirst write the spec as above, terminated by a NUL byte, to ${OPTS[1]}\n"
+		          "\tthen for each command line write the number of arguments and the arguments,\n"
+		          "\teach terminated by a NUL byte, e.g. printf '%s\\0' $# \"$@\" >&${OPTS[1]}\n"
+		          "\tthe reply is the shell code a single invocation prints, terminated by a NUL byte,\n"
+		          "\tit ends with 'false' if the command line was not accepted, read it with\n"
+		          "\tIFS= read -r -d '' -u ${OPTS[0]} reply; eval \"$reply\" || exit\n"
+		          "To check or expand many stored command lines at once use\n"
+		          "shellScriptOptionParser --batch|--batch0 shell|json|nul recordFile\n"
+		          "\twith the spec on standard input as above. recordFile holds one command line,\n"
+		          "\tprogram name first and quoted as in a shell, per line (--batch0: NUL-terminated).\n"
+		          "\tThe standard options like --help are not available, config files are read.\n"
+		          "\tOne result per record is written, in json and nul without shell escapes:\n"
+		          "\t  shell: the shell code as above, terminated by a NUL byte,\n"
+		          "\t    errors as comments followed by 'false'\n"
+		          "\t  json: one line {\"record\":n,\"values\":{...},\"arguments\":[...]} per record,\n"
+		          "\t    with \"afterMinusMinus\" if minusMinusSpecialTreatment is set, or {\"record\":n,\"error\":...}\n"
+		          "\t  nul: NUL-terminated name and value pairs, one per value, 'name[key]' for maps,\n"
+		          "\t    '@' for unused parameters and '!' for an error, an empty name ends the record\n"
+		          "\tthe exit code is 1 if any record was not accepted\n";
 
 		return (1);
 	}
 
-	std::vector<options::base*> options;
-	std::set<const options::base*> exportedOptions;
-	std::string minusMinusSpecialTreatment = "";
-	std::vector<std::string> searchPath({"/etc/", "~/.", "~/.config/", "./."});
-
-	unsigned int minUnusedParameters = 0;
-	unsigned int maxUnusedParameters = std::numeric_limits<unsigned int>::max();
-	{
-		options::parser throwAwayInstance("tAI1");
-		std::string keyWord;
-		bool exportNextOption = false;
-		typeModifierType nextOptionAsWhat = kSimple;
-		int nextOptionPositional = 0;
-		while (std::cin.good()) {
-			std::cin >> keyWord;
-			if (std::cin.eof()) {
-				break;
-			}
-			if (keyWord == "string") {
-				options.push_back(fOptionFromStream<std::string>(std::cin, "", nextOptionAsWhat));
-			} else if (keyWord == "int") {
-				options.push_back(fOptionFromStream<int>(std::cin, 0, nextOptionAsWhat));
-			} else if (keyWord == "uint") {
-				options.push_back(fOptionFromStream<unsigned int>(std::cin, 0, nextOptionAsWhat));
-			} else if (keyWord == "size") {
-				options.push_back(fOptionFromStream<options::postFixedNumber<size_t>>(std::cin, 0, nextOptionAsWhat));
-			} else if (keyWord == "bool") {
-				options.push_back(fOptionFromStream<bool>(std::cin, false, nextOptionAsWhat));
-			} else if (keyWord == "seconds") {
-				options.push_back(fOptionFromStream<std::chrono::duration<long long>>(std::cin, std::chrono::seconds(1), nextOptionAsWhat));
-			} else if (keyWord == "milliseconds") {
-				options.push_back(fOptionFromStream<std::chrono::duration<long long, std::milli>>(std::cin, std::chrono::seconds(1), nextOptionAsWhat));
-			} else if (keyWord == "microseconds") {
-				options.push_back(fOptionFromStream<std::chrono::duration<long long, std::micro>>(std::cin, std::chrono::seconds(1), nextOptionAsWhat));
-			} else if (keyWord == "date") {
-				options.push_back(fOptionFromStream<std::chrono::system_clock::time_point>(std::cin, std::chrono::system_clock::now(), nextOptionAsWhat));
-			} else if (keyWord == "idate") {
-				options.push_back(fOptionFromStream<std::chrono::system_clock::time_point>(std::cin, std::chrono::system_clock::now(), nextOptionAsWhat));
-				auto opt = dynamic_cast<options::valuePrinter<std::chrono::system_clock::time_point>*>(options.back());
-				if (opt) {
-					opt->fSetValuePrinter([](std::ostream & aStream, const std::chrono::system_clock::time_point & aValue)->void {aStream << std::chrono::duration_cast<std::chrono::duration<long>>(aValue.time_since_epoch()).count();});
-				}
-			} else if (keyWord == "range") {
-				options.back()->fAddToRangeFromStream(std::cin);
-			} else if (keyWord == "default") {
-				options.back()->fAddDefaultFromStream(std::cin);
-			} else if (keyWord == "export") {
-				exportNextOption = true;
-				continue;
-			} else if (keyWord == "array") {
-				nextOptionAsWhat = kAsArray;
-				continue;
-			} else if (keyWord == "map") {
-				nextOptionAsWhat = kAsMap;
-				continue;
-			} else if (keyWord == "list") {
-				nextOptionAsWhat = kAsList;
-				continue;
-			} else if (keyWord == "positional") {
-				std::cin >> nextOptionPositional;
-				continue;
-			} else if (keyWord == "minusMinusSpecialTreatment") {
-				std::cin >> minusMinusSpecialTreatment;
-				continue;
-			} else if (keyWord == "minUnusedParameters") {
-				std::cin >> minUnusedParameters;
-				continue;
-			} else if (keyWord == "maxUnusedParameters") {
-				std::cin >> maxUnusedParameters;
-				continue;
-			} else if (keyWord == "noPath") {
-				searchPath.clear();
-				continue;
-			} else if (keyWord == "path") {
-				std::string buffer;
-				using options::escapedIO::operator>>;
-				std::cin >> buffer;
-				searchPath.push_back(buffer);
-			} else if (keyWord == "trailer:") {
-				break;
-			} else {
-				std::cerr << "illegal option type '" << keyWord << "', giving up" << std::endl;
-				return 1;
-			}
-			if (nextOptionPositional != 0) {
-				options::internal::positional_base(nextOptionPositional, options.back());
-			}
-			if (exportNextOption) {
-				exportedOptions.insert(options.back());
+	auto cacheFileName = fSpecCacheFileName(specText);
+	compiledSpec compiled;
+	if (coprocess || batch) {
+		std::vector<options::base*> options;
+		bool specIsGood;
+		{
+			options::parserContext compileContext; // keeps the options made while checking the spec out of the global option set
+			specIsGood = fLoadSpec(spec, specText, cacheFileName, compiled, options);
+			for (auto option : options) {
+				delete option;
 			}
-			exportNextOption = false;
-			nextOptionAsWhat = kSimple;
-			nextOptionPositional = 0;
 		}
-	}
-	std::string trailer;
-	while (std::cin.good()) {
-		std::string line;
-		if (std::cin.eof()) {
-			break;
+		if (!specIsGood) {
+			return 1;
 		}
-		std::getline(std::cin, line);
-		trailer += line;
-		trailer += "\n";
-	}
-
-	options::parser parser(description, trailer, searchPath);
-	parser.fSetMessageStream(&std::cerr);
-	parser.fSetHelpReturnValue(1);
-	parser.fSetExecutableName(argv[1]);
-	if (! minusMinusSpecialTreatment.empty()) {
-		parser.fSetMinusMinusStartsExtraList();
-	}
-
-	auto unusedOptions = parser.fParse(argc - 1, argv + 1);
-
-	if (unusedOptions.size() < minUnusedParameters ||
-	        unusedOptions.size() > maxUnusedParameters) {
-		std::cerr << "illegal number of non-option parameters " << unusedOptions.size() << ", must be between " << minUnusedParameters << " and " << maxUnusedParameters << std::endl;
-		parser.fHelp();
-		return (1);
-	}
-
-
-	for (auto option : options) {
-		if (exportedOptions.find(option) != exportedOptions.end()) {
-			std::cout << "export ";
+		if (coprocess) {
+			return fServe(compiled, description, cacheFileName, argv[0], argv[2]);
 		}
-		std::cout << option->fGetLongName() << "=";
-		option->fWriteValue(std::cout);
-		std::cout << "\n";
-	}
-	std::cout << "shift $#\n";
-	if (unusedOptions.empty() == false) {
-		std::cout << "set --";
-		for (auto & unusedOption : unusedOptions) {
-			std::cout << " " << unusedOption;
+		batchFormatType format;
+		if (strcmp(argv[2], "shell") == 0) {
+			format = kShellCode;
+		} else if (strcmp(argv[2], "json") == 0) {
+			format = kJson;
+		} else if (strcmp(argv[2], "nul") == 0) {
+			format = kNulPairs;
+		} else {
+			std::cerr << "unknown batch output format '" << argv[2] << "', must be one of shell, json or nul" << std::endl;
+			return 1;
 		}
-		std::cout << "\n";
-	}
-	if (parser.fGetStuffAfterMinusMinus().empty() == false) {
-		std::cout << minusMinusSpecialTreatment << "=\"";
-		for (auto it =  parser.fGetStuffAfterMinusMinus().begin(); it != parser.fGetStuffAfterMinusMinus().end(); ++it) {
-			if (it != parser.fGetStuffAfterMinusMinus().begin()) {
-				std::cout << " ";
-			}
-			std::cout << *it;
+		std::ifstream records(argv[3]);
+		if (!records.is_open()) {
+			std::cerr << "can't open '" << argv[3] << "': " << strerror(errno) << std::endl;
+			return 1;
 		}
-		std::cout << "\"\n";
+		return fRunBatch(records, argv[1][7] == '0' ? '\0' : '\n', format, compiled);
 	}
 
-	return 0;
+	std::vector<options::base*> options;
+	{
+		options::parser throwAwayInstance("tAI1", "", {});
+		if (!fLoadSpec(spec, specText, cacheFileName, compiled, options)) {
+			return 1;
+		}
+	}
+	return fParseAndPrint(options, compiled, description, "", argc, argv);
 }
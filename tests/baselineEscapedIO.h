@@ -0,0 +1,131 @@
+#ifndef __baselineEscapedIO_H__
+#define __baselineEscapedIO_H__
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/// the escaped string I/O as it was before it was optimised, the reference for the differential tests and benchmarks
+namespace baseline {
+	inline std::istream& fReadEscapedString(std::istream& aStream, std::string& aString) {
+		std::istream::sentry s(aStream);
+		if (s) {
+			aString.clear();
+			auto delimiter = aStream.peek();
+			if (delimiter == '"' || delimiter == '\'') { // string is enclosed in a pair of delimiters
+				aStream.get();
+			} else {
+				delimiter = '\0';
+			}
+			while (! aStream.eof()) {
+				auto c = aStream.peek();
+				if (c == '\n' || aStream.eof()) {
+					break;
+				}
+				aStream.get();
+				if (c == '\\') {
+					c = aStream.get();
+					switch (c) {
+						case 'a':
+							aString.push_back('\a');
+							break;
+						case 'b':
+							aString.push_back('\b');
+							break;
+						case 'f':
+							aString.push_back('\f');
+							break;
+						case 'n':
+							aString.push_back('\n');
+							break;
+						case 'r':
+							aString.push_back('\r');
+							break;
+						case 't':
+							aString.push_back('\t');
+							break;
+						case 'v':
+							aString.push_back('\v');
+							break;
+						default:
+							if (c >= '0' && c <= '7') {
+								char ch = 0;
+								for (int i = 0; i < 3 && c >= '0' && c <= '7'; i++) {
+									ch = (ch << 3) | ((c - '0') & 0x7);
+									c = aStream.get();
+								}
+								aString.push_back(ch);
+							} else {
+								aString.push_back(c);
+							}
+							break;
+					}
+				} else if (c == delimiter) {
+					break;
+				} else {
+					aString.push_back(c);
+				}
+			}
+		}
+		auto eof = aStream.eof();
+		aStream.clear();
+		if (eof) {
+			aStream.setstate(std::ios_base::eofbit);
+		};
+		return aStream;
+	}
+	inline void fPrintEscapedString(std::ostream& aStream, const std::string& aString) {
+		bool delimit = aString.find_first_of(" \t,") != std::string::npos;
+		if (delimit) {
+			aStream << '\'';
+		}
+		for (auto c : aString) {
+			switch (c) {
+				case '\a':
+					aStream << "\\a";
+					break;
+				case '\b':
+					aStream << "\\b";
+					break;
+				case '\f':
+					aStream << "\\f";
+					break;
+				case '\n':
+					aStream << "\\n";
+					break;
+				case '\r':
+					aStream << "\\r";
+					break;
+				case '\t':
+					aStream << "\\t";
+					break;
+				case ' ':
+					aStream << "\\ ";
+					break;
+				case '\v':
+					aStream << "\\v";
+					break;
+				case '\\':
+					aStream << "\\\\";
+					break;
+				case '\'':
+					aStream << "\\\'";
+					break;
+				case '"':
+					aStream << "\\\"";
+					break;
+				default:
+					if (c >= ' ' && c < 127) {
+						aStream << c;
+					} else {
+						aStream << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned int>(c) << std::setfill(' ') << std::dec;
+					}
+			}
+		}
+		if (delimit) {
+			aStream << '\'';
+		}
+	}
+} // end of namespace baseline
+
+#endif
@@ -0,0 +1,30 @@
+#include "OptionsChrono.h"
+#include <cstdio>
+#include <cstdlib>
+
+/// time parseDurationString over typical strings, for integral and floating point durations
+int main(int argc, char* argv[]) {
+	long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+	options::parserContext context;
+	const char* inputs[] = {"5s", "250 ms", "1 hour 30 min", "2 weeks 3 hours 4 min", "1.5 seconds", "10 us"};
+	long long sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) {
+		std::chrono::duration<long long, std::nano> duration;
+		options::internal::parseDurationString(duration, inputs[i % 6]);
+		sum += duration.count();
+	}
+	auto middle = std::chrono::steady_clock::now();
+	double floatingSum = 0;
+	for (long i = 0; i < iterations; i++) {
+		std::chrono::duration<double> duration;
+		options::internal::parseDurationString(duration, inputs[i % 6]);
+		floatingSum += duration.count();
+	}
+	auto end = std::chrono::steady_clock::now();
+	printf("%ld integral durations: %.0f ms (sum %lld ns)\n", iterations,
+	       std::chrono::duration<double, std::milli>(middle - start).count(), sum);
+	printf("%ld floating point durations: %.0f ms (sum %g s)\n", iterations,
+	       std::chrono::duration<double, std::milli>(end - middle).count(), floatingSum);
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include "Options.h"
+#include "baselineEscapedIO.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/// print many file names and one big value with the baseline printer and the current one
+int main(int argc, char* argv[]) {
+	int nNames = argc > 1 ? std::atoi(argv[1]) : 300000;
+	std::vector<std::string> names;
+	for (int i = 0; i < nNames; i++) {
+		names.push_back("/data/run" + std::to_string(i) + "/file_" + std::to_string(i * 7) + ".root");
+	}
+	std::string big(nNames * 28, 'x');
+	for (std::size_t i = 0; i < big.size(); i += 100) {
+		big[i] = ' ';
+	}
+	for (bool current : {false, true}) {
+		std::ostringstream namesStream;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& name : names) {
+			if (current) {
+				options::parser::fPrintEscapedString(namesStream, name);
+			} else {
+				baseline::fPrintEscapedString(namesStream, name);
+			}
+			namesStream << ' ';
+		}
+		auto middle = std::chrono::steady_clock::now();
+		std::ostringstream bigStream;
+		if (current) {
+			options::parser::fPrintEscapedString(bigStream, big);
+		} else {
+			baseline::fPrintEscapedString(bigStream, big);
+		}
+		auto end = std::chrono::steady_clock::now();
+		printf("%s printer: %d file names %.1f ms, %zu byte value %.1f ms\n", current ? "current" : "baseline", nNames,
+		       std::chrono::duration<double, std::milli>(middle - start).count(), big.size(),
+		       std::chrono::duration<double, std::milli>(end - middle).count());
+	}
+	return 0;
+}
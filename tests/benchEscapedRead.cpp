@@ -0,0 +1,37 @@
+#include "Options.h"
+#include "baselineEscapedIO.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/// read multi-megabyte escaped values with the baseline reader and the current one
+int main(int argc, char* argv[]) {
+	std::size_t size = argc > 1 ? std::atol(argv[1]) : 8 * 1024 * 1024;
+	int repetitions = 5;
+	for (bool withEscapes : {false, true}) {
+		std::string input;
+		for (std::size_t i = 0; i < size; i++) {
+			input += (withEscapes && i % 64 == 0) ? '\\' : "abcdefghij klm"[i % 14];
+		}
+		input += '\n';
+		for (bool current : {false, true}) {
+			std::istringstream stream(input);
+			std::string value;
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < repetitions; i++) {
+				stream.clear();
+				stream.seekg(0);
+				if (current) {
+					using options::escapedIO::operator>>;
+					stream >> value;
+				} else {
+					baseline::fReadEscapedString(stream, value);
+				}
+			}
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			printf("%s, %s reader: %.1f MB/s (%zu chars)\n", withEscapes ? "one escape per 64 chars" : "no escapes", current ? "current" : "baseline",
+			       repetitions * input.size() / 1e6 / elapsed.count(), value.size());
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include "Options.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+
+/// parser context giving access to its option index
+class indexedContext: public options::parserContext {
+  public:
+	using parser::fGetOptionIndex;
+};
+
+/// look up long option names in a std::map like the registries before the index did and in the option index
+int main(int argc, char* argv[]) {
+	long lookups = argc > 1 ? std::atol(argv[1]) : 1000000;
+	int nOptions = 1800;
+	indexedContext context;
+	std::vector<std::unique_ptr<options::single<int>>> registered;
+	std::vector<std::string> names;
+	for (int i = 0; i < nOptions; i++) {
+		names.push_back("someOption" + std::to_string(i * 7919 % nOptions) + "Name");
+		registered.emplace_back(new options::single<int>('\0', names.back(), "for the benchmark", i));
+	}
+	std::map<std::string, options::base*> byLongName;
+	for (auto& option : registered) {
+		byLongName[option->fGetLongName()] = option.get();
+	}
+	auto& index = context.fGetOptionIndex();
+
+	std::size_t found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < lookups; i++) {
+		const auto& name = names[i % nOptions];
+		auto it = byLongName.find(std::string(name.data(), name.size()));
+		found += it != byLongName.end();
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (long i = 0; i < lookups; i++) {
+		const auto& name = names[i % nOptions];
+		found += index.fFind(name.data(), name.size()) != nullptr;
+	}
+	auto end = std::chrono::steady_clock::now();
+	printf("%d options, %ld lookups each: std::map::find %.1f ns/lookup, optionIndex::fFind %.1f ns/lookup (%zu found)\n",
+	       nOptions, lookups, std::chrono::duration<double, std::nano>(middle - start).count() / lookups,
+	       std::chrono::duration<double, std::nano>(end - middle).count() / lookups, found);
+	return found == static_cast<std::size_t>(2 * lookups) ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "Options.h"
+#include "testTools.h"
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// option that can be disabled like by a "## disable" line in a config file
+class disableable: public options::single<int> {
+  public:
+	using options::single<int>::single;
+	using options::single<int>::fDisable;
+};
+
+/// parse aArgs into a context with options a, b, c and d and the rules set by aSetup, true if the rules hold
+static bool fRulesHold(const std::vector<std::string>& aArgs, const std::function<void(options::parserContext&, options::single<int>*[4])>& aSetup) {
+	options::parserContext context;
+	options::single<int> a('\0', "a", "option a");
+	options::single<int> b('\0', "b", "option b");
+	options::single<int> c('\0', "c", "option c");
+	disableable d('\0', "d", "option d", 0);
+	options::single<int>* opts[4] = {&a, &b, &c, &d};
+	aSetup(context, opts);
+	std::vector<std::string> args{"test"};
+	args.insert(args.end(), aArgs.begin(), aArgs.end());
+	try {
+		context.fParse(args);
+	} catch (const options::internal::parseError&) {
+		return false;
+	}
+	return true;
+}
+
+int main() {
+	auto aRequiresBTwice = [](options::parserContext&, options::single<int>* aOpts[4]) {
+		aOpts[0]->fRequire(aOpts[1]);
+		aOpts[0]->fRequire(aOpts[1]);
+	};
+	testTools::fCheck(fRulesHold({"--a", "1", "--b", "2"}, aRequiresBTwice), "requirement given twice is met");
+	testTools::fCheck(!fRulesHold({"--a", "1"}, aRequiresBTwice), "requirement not met");
+	testTools::fCheck(fRulesHold({"--b", "1"}, aRequiresBTwice), "requirement of an unset option");
+
+	auto aForbidsC = [](options::parserContext&, options::single<int>* aOpts[4]) {
+		aOpts[0]->fForbid(aOpts[2]);
+	};
+	testTools::fCheck(!fRulesHold({"--a", "1", "--c", "2"}, aForbidsC), "forbidden option given");
+	testTools::fCheck(fRulesHold({"--a", "1", "--b", "2"}, aForbidsC), "forbidden option not given");
+
+	auto exactlyOne = [](options::parserContext & aContext, options::single<int>* aOpts[4]) {
+		aContext.fRequireExactlyOneOf({aOpts[0], aOpts[1]});
+	};
+	testTools::fCheck(fRulesHold({"--a", "1"}, exactlyOne), "exactly one given");
+	testTools::fCheck(!fRulesHold({"--a", "1", "--b", "1"}, exactlyOne), "two of exactly one given");
+	testTools::fCheck(!fRulesHold({"--c", "1"}, exactlyOne), "none of exactly one given");
+
+	auto allOrNone = [](options::parserContext & aContext, options::single<int>* aOpts[4]) {
+		aContext.fRequireAllOrNoneOf({aOpts[0], aOpts[1], aOpts[1]});
+	};
+	testTools::fCheck(fRulesHold({"--a", "1", "--b", "1"}, allOrNone), "all given");
+	testTools::fCheck(fRulesHold({"--c", "1"}, allOrNone), "none given");
+	testTools::fCheck(!fRulesHold({"--a", "1"}, allOrNone), "some given");
+
+	auto allOrNoneWithDisabled = [](options::parserContext & aContext, options::single<int>* aOpts[4]) {
+		aContext.fRequireAllOrNoneOf({aOpts[0], aOpts[1], aOpts[3]});
+		static_cast<disableable*>(aOpts[3])->fDisable();
+	};
+	testTools::fCheck(!fRulesHold({"--a", "1", "--b", "1"}, allOrNoneWithDisabled), "all but a disabled member given");
+	testTools::fCheck(fRulesHold({"--c", "1"}, allOrNoneWithDisabled), "no member given while one is disabled");
+
+	auto required = [](options::parserContext & aContext, options::single<int>* aOpts[4]) {
+		aContext.fRequire(aOpts[2]);
+	};
+	testTools::fCheck(fRulesHold({"--c", "1"}, required), "required option given");
+	testTools::fCheck(!fRulesHold({"--a", "1"}, required), "required option missing");
+	return testTools::fResult();
+}
@@ -0,0 +1,122 @@
+#include "Options.h"
+#include "OptionsControlSocket.h"
+#include "testTools.h"
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+TEST_TOOLS_DEFINE_GLOBALS
+
+static int fConnect(const std::string& aPath) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, aPath.c_str(), sizeof(address.sun_path) - 1);
+	auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/// read until the final "ok" or "error" line or aTimeoutMs passed without data
+static std::string fReadReply(int aFd, int aTimeoutMs) {
+	std::string reply;
+	char chunk[256];
+	while (reply.find("ok\n") == std::string::npos
+	        && (reply.find("error") == std::string::npos || reply.back() != '\n')) {
+		pollfd fds[1] = {{aFd, POLLIN, 0}};
+		if (poll(fds, 1, aTimeoutMs) <= 0) {
+			break;
+		}
+		auto n = read(aFd, chunk, sizeof(chunk));
+		if (n <= 0) {
+			break;
+		}
+		reply.append(chunk, n);
+	}
+	return reply;
+}
+
+/// send aCommand and return the reply to it
+static std::string fAsk(int aFd, const std::string& aCommand) {
+	auto line = aCommand + "\n";
+	if (write(aFd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+		return "";
+	}
+	return fReadReply(aFd, 5000);
+}
+
+/// the socket is private to the owner, an idle client does not block the next one and the commands give the documented replies
+int main() {
+	char dirTemplate[] = "/tmp/testControlSocketXXXXXX";
+	std::string dir(mkdtemp(dirTemplate));
+	auto path = dir + "/control";
+	close(creat(path.c_str(), 0644)); // a stale leftover is replaced
+
+	options::parserContext context;
+	options::liveTunable<int> number('\0', "number", "queried via the socket", 42);
+	number.fAddToRange(options::interval<int>(0, 100));
+	options::single<int> fixed('\0', "fixed", "not changeable at runtime", 7);
+	context.fParse(std::vector<std::string> {"test"});
+	{
+		options::controlSocket control(context, path, std::chrono::milliseconds(200));
+		struct stat status;
+		testTools::fCheck(stat(path.c_str(), &status) == 0, "socket exists");
+		testTools::fCheck(S_ISSOCK(status.st_mode), "stale file replaced by socket");
+		testTools::fCheckEqual(status.st_mode & 0777, 0600u, "socket permissions");
+
+		auto idleClient = fConnect(path);
+		testTools::fCheck(idleClient >= 0, "idle client connects");
+		auto client = fConnect(path);
+		testTools::fCheck(client >= 0, "second client connects");
+		std::string command("get number\n");
+		testTools::fCheck(write(client, command.data(), command.size()) == static_cast<ssize_t>(command.size()), "command sent");
+		auto start = std::chrono::steady_clock::now();
+		auto reply = fReadReply(client, 5000);
+		auto waited = std::chrono::steady_clock::now() - start;
+		testTools::fCheckEqual(reply, std::string("42\nok\n"), "reply behind an idle client");
+		testTools::fCheck(waited < std::chrono::seconds(3), "idle client was disconnected in time");
+		close(client);
+		close(idleClient);
+
+		client = fConnect(path);
+		testTools::fCheck(client >= 0, "client for the commands connects");
+		testTools::fCheckEqual(fAsk(client, "source number"), std::string("unset\nok\n"), "source before set");
+		testTools::fCheckEqual(fAsk(client, "set number=43"), std::string("ok\n"), "set reply");
+		testTools::fCheckEqual(number.fGet(), 43, "value retuned by set");
+		testTools::fCheckEqual(fAsk(client, "get number"), std::string("43\nok\n"), "get after set");
+		testTools::fCheckEqual(fAsk(client, "source number"), std::string("controlSocket:1\nok\n"), "source after set");
+		testTools::fCheckEqual(fAsk(client, "set fixed=8"), std::string("error: option 'fixed' can not be changed at runtime\n"), "set of a plain option");
+		testTools::fCheckEqual(fixed.fGetValue(), 7, "plain option unchanged");
+		testTools::fCheckEqual(fAsk(client, "set number=101"), std::string("error: value '101' out of range for option 'number'\n"), "range error reply");
+		testTools::fCheckEqual(fAsk(client, "set number=many"), std::string("error: can not convert 'many' for option 'number'\n"), "conversion error reply");
+		testTools::fCheckEqual(number.fGet(), 43, "value kept after failed sets");
+		testTools::fCheckEqual(fAsk(client, "set number=44"), std::string("ok\n"), "second set reply");
+		testTools::fCheckEqual(fAsk(client, "source number"), std::string("controlSocket:2\nok\n"), "source counts the sets");
+		auto dump = "\n" + fAsk(client, "dump");
+		testTools::fCheck(dump.find("\nnumber=44\n") != std::string::npos, "set option dumped as is");
+		testTools::fCheck(dump.find("\n# fixed=7\n") != std::string::npos, "unset option commented out in dump");
+		testTools::fCheckEqual(dump.substr(dump.size() - 3), std::string("ok\n"), "dump ends with ok");
+		close(client);
+	}
+
+	auto dirStream = opendir(dir.c_str());
+	int leftovers = 0;
+	while (auto entry = readdir(dirStream)) {
+		if (entry->d_name[0] != '.' || strncmp(entry->d_name, ".controlSocket", 14) == 0) {
+			leftovers++;
+		}
+	}
+	closedir(dirStream);
+	testTools::fCheckEqual(leftovers, 0, "files left after the socket went away");
+	rmdir(dir.c_str());
+	return testTools::fResult();
+}
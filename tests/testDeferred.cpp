@@ -0,0 +1,24 @@
+#include "OptionsChrono.h"
+#include "testTools.h"
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// deferred values are converted together at the end of fParse, whichever way they are read
+int main() {
+	options::parserContext context;
+	context.fSetConversionsAreDeferred();
+	options::single<int> number('\0', "number", "last one wins", 0);
+	options::single<std::chrono::duration<double>> duration('\0', "duration", "a duration", std::chrono::seconds(1));
+	int numberSeenByAction = -1;
+	options::withAction<options::single<int>> trigger([&number, &numberSeenByAction](options::single<int>&) {
+		numberSeenByAction = number;
+	}, '\0', "trigger", "reads another option while parsing", 0);
+	context.fParse(std::vector<std::string> {"test", "--number", "not a number", "--number", "1",
+	                                         "--duration", "2 min", "--trigger", "1", "--number", "3"
+	                                        });
+	testTools::fCheckEqual(numberSeenByAction, 0, "deferred value seen while parsing");
+	testTools::fCheckEqual(static_cast<int>(number), 3, "implicit conversion after parsing");
+	testTools::fCheckEqual(number.fGetValue(), 3, "fGetValue after parsing");
+	testTools::fCheckEqual(duration.count(), 120.0, "chrono value after parsing");
+	testTools::fCheckEqual(trigger.fGetValue(), 1, "value of the non-deferrable option");
+	return testTools::fResult();
+}
@@ -0,0 +1,47 @@
+#include "OptionsChrono.h"
+#include "testTools.h"
+#include <cmath>
+TEST_TOOLS_DEFINE_GLOBALS
+
+template <class Rep, class Period> static Rep fParse(const std::string& aString) {
+	std::chrono::duration<Rep, Period> duration;
+	options::internal::parseDurationString(duration, aString);
+	return duration.count();
+}
+static bool fThrows(const std::string& aString) {
+	try {
+		fParse<long long, std::nano>(aString);
+	} catch (const std::runtime_error&) {
+		return true;
+	}
+	return false;
+}
+static bool fClose(double aGot, double aExpected) {
+	return std::abs(aGot - aExpected) <= 1e-12 * std::abs(aExpected);
+}
+
+/// integral durations are exact, floating point ones keep tiny and huge values
+int main() {
+	testTools::fCheckEqual(fParse<long long, std::nano>("0.3 s"), 300000000LL, "0.3 s exact");
+	testTools::fCheckEqual(fParse<long long, std::nano>("1 hour 30 min"), 5400000000000LL, "sum of terms");
+	testTools::fCheckEqual(fParse<long long, std::milli>("250 ms"), 250LL, "prefixed unit");
+	testTools::fCheckEqual(fParse<long long, std::ratio<1>>("2 kiloyears"), 63115000000LL, "enlarging prefix");
+	testTools::fCheck(fThrows("1e20 s"), "overflow of integral duration");
+	testTools::fCheck(fThrows("5"), "number without unit");
+	testTools::fCheck(fThrows("5 parsecs"), "unknown unit");
+
+	testTools::fCheck(fClose(fParse<double, std::ratio<1>>("1e-12 s"), 1e-12), "1e-12 s as double seconds");
+	testTools::fCheck(fClose(fParse<double, std::ratio<1>>("1e20 s"), 1e20), "1e20 s as double seconds");
+	testTools::fCheck(fClose(fParse<double, std::milli>("1.5 ms"), 1.5), "1.5 ms as double milliseconds");
+	testTools::fCheck(fClose(fParse<double, std::ratio<1>>("1 day -2.5 hours"), 77400), "negative term");
+	testTools::fCheck(std::abs(fParse<float, std::micro>("3 ns") - 0.003f) < 1e-9f, "float microseconds");
+
+	std::chrono::duration<double> duration;
+	int months = 0;
+	int years = 0;
+	options::internal::parseDurationString(duration, "2 months 1 year 3 s", &months, &years);
+	testTools::fCheckEqual(months, 2, "months kept apart");
+	testTools::fCheckEqual(years, 1, "years kept apart");
+	testTools::fCheck(fClose(duration.count(), 3), "seconds besides months and years");
+	return testTools::fResult();
+}
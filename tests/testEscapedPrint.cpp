@@ -0,0 +1,42 @@
+#include "Options.h"
+#include "baselineEscapedIO.h"
+#include "testTools.h"
+#include <cstdlib>
+#include <random>
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// random strings with all byte values print like the baseline, with the stream state left alone
+int main(int argc, char* argv[]) {
+	int rounds = argc > 1 ? std::atoi(argv[1]) : 30000;
+	std::mt19937 generator(7);
+	long mismatches = 0;
+	for (int round = 0; round < rounds; round++) {
+		std::string input;
+		auto length = generator() % 60;
+		for (unsigned i = 0; i < length; i++) {
+			input += (generator() % 4 == 0) ? static_cast<char>(generator() % 256) : "abc~!xyz0, "[generator() % 11];
+		}
+		for (int formatting = 0; formatting < 3; formatting++) {
+			std::ostringstream baselineStream;
+			std::ostringstream stream;
+			if (formatting > 0) {
+				baselineStream << std::setw(formatting * 3) << std::setfill('*') << std::hex;
+				stream << std::setw(formatting * 3) << std::setfill('*') << std::hex;
+			}
+			if (formatting == 2) {
+				baselineStream << std::left;
+				stream << std::left;
+			}
+			baseline::fPrintEscapedString(baselineStream, input);
+			options::parser::fPrintEscapedString(stream, input);
+			baselineStream << 255;
+			stream << 255;
+			if (stream.str() != baselineStream.str() || stream.fill() != baselineStream.fill() ||
+			        stream.flags() != baselineStream.flags() || stream.width() != baselineStream.width()) {
+				mismatches++;
+			}
+		}
+	}
+	testTools::fCheckEqual(mismatches, 0L, "outputs differing from the baseline printer");
+	return testTools::fResult();
+}
@@ -0,0 +1,99 @@
+#include "Options.h"
+#include "baselineEscapedIO.h"
+#include "testTools.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// streambuf over a string with a get area of at most lAreaSize chars, 0 means unbuffered with underflow and uflow only
+class smallAreaBuf: public std::streambuf {
+  protected:
+	std::string lData;
+	std::size_t lPosition;
+	std::size_t lAreaSize;
+	int_type underflow() override {
+		if (lAreaSize == 0) {
+			return lPosition >= lData.size() ? traits_type::eof() : traits_type::to_int_type(lData[lPosition]);
+		}
+		if (gptr() < egptr()) {
+			return traits_type::to_int_type(*gptr());
+		}
+		if (lPosition >= lData.size()) {
+			return traits_type::eof();
+		}
+		auto n = std::min(lAreaSize, lData.size() - lPosition);
+		auto begin = &lData[lPosition];
+		lPosition += n;
+		setg(begin, begin, begin + n);
+		return traits_type::to_int_type(*begin);
+	}
+	int_type uflow() override {
+		if (lAreaSize == 0) {
+			return lPosition >= lData.size() ? traits_type::eof() : traits_type::to_int_type(lData[lPosition++]);
+		}
+		return std::streambuf::uflow();
+	}
+  public:
+	smallAreaBuf(const std::string& aData, std::size_t aAreaSize):
+		lData(aData),
+		lPosition(0),
+		lAreaSize(aAreaSize) {
+	}
+};
+
+/// successive reads of random escaped input give the same values, stream states and rest as the baseline reader
+int main(int argc, char* argv[]) {
+	int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+	std::mt19937 generator(42);
+	const char alphabet[] = "ab \t\n\\\"'01789xnt\0\xff";
+	long mismatches = 0;
+	for (int round = 0; round < rounds; round++) {
+		std::string input;
+		auto length = generator() % 40;
+		for (unsigned i = 0; i < length; i++) {
+			if (generator() % 3 == 0) {
+				input += "plainrun";
+			} else {
+				input += alphabet[generator() % (sizeof(alphabet) - 1)];
+			}
+		}
+		for (std::size_t areaSize : {0, 1, 7, 4096}) {
+			for (bool skipWhiteSpace : {false, true}) {
+				smallAreaBuf baselineBuf(input, areaSize);
+				smallAreaBuf buf(input, areaSize);
+				std::istream baselineStream(&baselineBuf);
+				std::istream stream(&buf);
+				if (!skipWhiteSpace) {
+					baselineStream >> std::noskipws;
+					stream >> std::noskipws;
+				}
+				for (int read = 0; read < 5; read++) {
+					std::string baselineValue("junk");
+					std::string value("junk");
+					baseline::fReadEscapedString(baselineStream, baselineValue);
+					using options::escapedIO::operator>>;
+					stream >> value;
+					if (value != baselineValue || stream.rdstate() != baselineStream.rdstate()) {
+						mismatches++;
+						break;
+					}
+					if (baselineStream.eof()) {
+						break;
+					}
+					if (read % 2 != 0) {
+						baselineStream.ignore(1);
+						stream.ignore(1);
+					}
+				}
+				std::string baselineRest((std::istreambuf_iterator<char>(baselineStream)), std::istreambuf_iterator<char>());
+				std::string rest((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+				if (rest != baselineRest) {
+					mismatches++;
+				}
+			}
+		}
+	}
+	testTools::fCheckEqual(mismatches, 0L, "reads differing from the baseline reader");
+	return testTools::fResult();
+}
@@ -0,0 +1,50 @@
+#include "OptionsChrono.h"
+#include "OptionsHotReload.h"
+#include "testTools.h"
+#include <fstream>
+#include <unistd.h>
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// a reload publishes the options that can be copied and reports the ones that can not
+int main() {
+	char directory[] = "/tmp/testHotReloadXXXXXX";
+	if (mkdtemp(directory) == nullptr) {
+		return 1;
+	}
+	std::string cfgFileName = std::string(directory) + "/test"; // search path and program name
+	{
+		std::ofstream cfg(cfgFileName);
+		cfg << "number=1\ncounted=1\n";
+	}
+	int actionCalls = 0;
+	{
+		options::parser parser("", "", {std::string(directory) + "/"});
+		options::single<int> number('\0', "number", "reloadable");
+		options::withAction<options::single<int>> counted([&actionCalls](options::single<int>&) {
+			actionCalls++;
+		}, '\0', "counted", "with an action, not reloadable");
+		options::single<std::chrono::duration<double>> timeout('\0', "timeout", "chrono, not reloadable", std::chrono::seconds(1));
+		parser.fSetCfgFilesAreWatched();
+		const char* argv[] = {"test", nullptr};
+		parser.fParse(1, argv);
+		testTools::fCheckEqual(actionCalls, 1, "action run at startup");
+		auto watcher = parser.fGetCfgWatcher();
+		testTools::fCheck(watcher != nullptr, "watcher exists");
+		if (watcher != nullptr) {
+			{
+				std::ofstream cfg(cfgFileName);
+				cfg << "number=2\ncounted=2\n";
+			}
+			testTools::fCheck(watcher->fReload(), "reload succeeds");
+			options::cfgWatcher::reader config(*watcher);
+			testTools::fCheckEqual(config.fGet(number).fGetValue(), 2, "reloaded value");
+			testTools::fCheckEqual(config.fGet(counted).fGetValue(), 1, "value with action keeps the startup value");
+			testTools::fCheckEqual(actionCalls, 1, "action not run on reload");
+			testTools::fCheck(watcher->fGetLastError().find("--counted") != std::string::npos, "ignored option reported");
+			testTools::fCheck(watcher->fGetLastError().find("--timeout") == std::string::npos, "option not in the config file not reported");
+		}
+	}
+	unlink(cfgFileName.c_str());
+	rmdir(directory);
+	return testTools::fResult();
+}
@@ -0,0 +1,37 @@
+#include "Options.h"
+#include "testTools.h"
+#include <atomic>
+#include <thread>
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// readers copy consistent values of a string liveTunable while it is retuned over and over
+int main() {
+	options::parserContext context;
+	options::liveTunable<std::string> name('\0', "name", "retuned while read", "value0");
+	context.fParse(std::vector<std::string> {"test"});
+	std::atomic<bool> done(false);
+	std::atomic<long> badReads(0);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; i++) {
+		readers.emplace_back([&name, &done, &badReads]() {
+			while (!done.load()) {
+				std::string value = name.fGet();
+				if (value.compare(0, 5, "value") != 0 || value.size() < 6) {
+					badReads++;
+				}
+			}
+		});
+	}
+	for (int i = 1; i <= 20000; i++) {
+		name.fSet("value" + std::to_string(i) + std::string(i % 64, 'x'));
+	}
+	done.store(true);
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	testTools::fCheckEqual(badReads.load(), 0L, "reads of inconsistent values");
+	testTools::fCheckEqual(name.fGet(), "value20000" + std::string(20000 % 64, 'x'), "last value");
+	name.fRetune("retuned", options::internal::sourceItem());
+	testTools::fCheckEqual(name.fGet(), std::string("retuned"), "retuned value");
+	return testTools::fResult();
+}
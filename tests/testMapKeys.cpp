@@ -0,0 +1,30 @@
+#include "Options.h"
+#include "testTools.h"
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// map keys must be read the same way on the direct conversion path and on the stream path
+int main() {
+	options::parserContext context;
+	options::map<int> direct('\0', "direct", "int values, converted without a stream");
+	options::map<std::string> streamed('\0', "streamed", "string values, converted through a stream");
+	context.fParse(std::vector<std::string> {"test",
+	               "--direct", "my key:5", "--direct", "\"q k\":6", "--direct", " plain :7",
+	               "--streamed", "my key:5", "--streamed", "\"q k\":6", "--streamed", " plain :7"
+	                                          });
+	testTools::fCheckEqual(direct.size(), 3u, "number of direct keys");
+	testTools::fCheckEqual(direct.count("my key"), 1u, "direct key with a space");
+	testTools::fCheckEqual(direct.count("q k"), 1u, "direct quoted key");
+	testTools::fCheck(direct.count("my key") == 1 && direct.at("my key") == 5, "value of direct key with a space");
+	testTools::fCheck(direct.count("q k") == 1 && direct.at("q k") == 6, "value of direct quoted key");
+	auto itDirect = direct.begin();
+	for (const auto& pair : streamed) {
+		if (itDirect == direct.end()) {
+			break;
+		}
+		testTools::fCheckEqual(itDirect->first, pair.first, "direct key equals streamed key");
+		++itDirect;
+	}
+	testTools::fCheckEqual(streamed.size(), direct.size(), "number of streamed keys");
+
+	return testTools::fResult();
+}
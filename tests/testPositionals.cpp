@@ -0,0 +1,37 @@
+#include "Options.h"
+#include "testTools.h"
+#include <fstream>
+#include <unistd.h>
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// command line positionals take precedence over a later --readCfgFile, with and without streaming
+int main(int argc, char* argv[]) {
+	bool streamed = argc > 1 && std::string(argv[1]) == "stream";
+	char cfgFileName[] = "/tmp/testPositionalsXXXXXX";
+	auto fd = mkstemp(cfgFileName);
+	if (fd < 0) {
+		return 1;
+	}
+	close(fd);
+	{
+		std::ofstream cfg(cfgFileName);
+		cfg << "first=fromCfg\nlast=fromCfg\nrest=fromCfg\n";
+	}
+	options::parser parser("", "", {});
+	options::positional<options::single<std::string>> first(1, "first", "in front of the container", "default");
+	options::positional<options::container<std::string>> rest(2, "rest", "the container");
+	options::positional<options::single<std::string>> last(3, "last", "behind the container", "default");
+	if (streamed) {
+		parser.fSetPositionalsAreStreamed();
+	}
+	const char* args[] = {"test", "a", "b", "c", "--readCfgFile", cfgFileName, "d", nullptr};
+	parser.fParse(7, args);
+	unlink(cfgFileName);
+	testTools::fCheckEqual(first.fGetValue(), std::string("a"), "positional in front of the container");
+	testTools::fCheckEqual(last.fGetValue(), std::string("d"), "positional behind the container");
+	testTools::fCheckEqual(rest.size(), 3u, "container size");
+	testTools::fCheck(std::find(rest.begin(), rest.end(), "fromCfg") != rest.end(), "config value in the container");
+	testTools::fCheck(std::find(rest.begin(), rest.end(), "b") != rest.end() &&
+	                  std::find(rest.begin(), rest.end(), "c") != rest.end(), "command line values in the container");
+	return testTools::fResult();
+}
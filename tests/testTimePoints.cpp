@@ -0,0 +1,37 @@
+#include "OptionsChrono.h"
+#include "testTools.h"
+TEST_TOOLS_DEFINE_GLOBALS
+
+/// all relative time points of one parse refer to the same "now"
+int main() {
+	options::parserContext context;
+	options::container<std::chrono::system_clock::time_point> list('\0', "list", "time points");
+	options::map<std::chrono::system_clock::time_point> named('\0', "named", "time points by name");
+	options::single<std::chrono::system_clock::time_point> single('\0', "single", "a time point");
+	std::vector<std::string> args{"test", "--single", "now"};
+	for (int i = 0; i < 1000; i++) {
+		args.push_back("--list");
+		args.push_back(i % 2 == 0 ? "now" : "1 day after now");
+		args.push_back("--named");
+		args.push_back("k" + std::to_string(i) + ":now");
+	}
+	context.fParse(args);
+	std::chrono::system_clock::time_point now = single;
+	int wrong = 0;
+	for (std::size_t i = 0; i < list.size(); i++) {
+		auto expected = i % 2 == 0 ? now : now + std::chrono::hours(24);
+		if (list[i] != expected) {
+			wrong++;
+		}
+	}
+	testTools::fCheckEqual(wrong, 0, "container elements differing from the now of the parse");
+	wrong = 0;
+	for (const auto& pair : named) {
+		if (pair.second != now) {
+			wrong++;
+		}
+	}
+	testTools::fCheckEqual(wrong, 0, "map elements differing from the now of the parse");
+	testTools::fCheck(options::internal::fGetParseTimePointReference() == nullptr, "no shared reference after the parse");
+	return testTools::fResult();
+}
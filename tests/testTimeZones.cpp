@@ -0,0 +1,45 @@
+#include "OptionsChrono.h"
+#include "testTools.h"
+#include <stdlib.h>
+#include <unistd.h>
+TEST_TOOLS_DEFINE_GLOBALS
+
+static long long fParse(const std::string& aString) {
+	return std::chrono::system_clock::to_time_t(options::internal::fParseTimePointString(aString));
+}
+
+/// local times in DST gaps and folds resolve like glibc's mktime with tm_isdst = -1 in a fresh process, an unknown local zone is UTC
+int main() {
+	struct expectation {
+		const char* lZone;
+		const char* lTime;
+		long long lExpected;
+		const char* lWhat;
+	};
+	const expectation expectations[] = {
+		{"Europe/Berlin", "2024/10/27 2:30:00", 1729992600, "fold resolves to standard time"},
+		{"Europe/Berlin", "2024/10/27 1:30:00", 1729985400, "before the fold"},
+		{"Europe/Berlin", "2024/10/27 3:00:00", 1729994400, "after the fold"},
+		{"Europe/Berlin", "2024/03/31 2:30:00", 1711848600, "gap"},
+		{"Europe/Berlin", "1 month before 2024/11/27 2:30", 1729992600, "relative into the fold"},
+		{"Australia/Sydney", "2024/04/07 2:30:00", 1712421000, "fold east of UTC"},
+		{"Australia/Sydney", "2024/10/06 2:30:00", 1728145800, "gap east of UTC"},
+		{"America/New_York", "2024/11/03 1:30:00", 1730611800, "fold west of UTC"},
+		{"America/New_York", "2024/03/10 2:30:00", 1710055800, "gap west of UTC"},
+		{"Europe/Dublin", "2024/10/27 1:30:00", 1729992600, "fold with negative DST"},
+		{"Europe/Dublin", "2024/03/31 1:30:00", 1711845000, "gap with negative DST"},
+		{"Australia/Lord_Howe", "2024/04/07 1:45:00", 1712416500, "half hour fold"}
+	};
+	for (const auto& item : expectations) {
+		if (access((std::string("/usr/share/zoneinfo/") + item.lZone).c_str(), R_OK) != 0) {
+			continue;
+		}
+		setenv("TZ", item.lZone, 1);
+		testTools::fCheckEqual(fParse(item.lTime), item.lExpected, std::string(item.lZone) + " " + item.lTime + ": " + item.lWhat);
+	}
+	setenv("TZ", "No/Such_Zone", 1);
+	for (int i = 0; i < 2; i++) { // the second lookup uses the cached decision
+		testTools::fCheckEqual(fParse("2024/10/27 2:30:00"), 1729996200ll, "unknown local zone is UTC");
+	}
+	return testTools::fResult();
+}
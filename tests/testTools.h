@@ -0,0 +1,37 @@
+#ifndef __testTools_H__
+#define __testTools_H__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/// minimal helpers for the test executables, which return non-zero when a check failed
+namespace testTools {
+	extern int gFailures;
+	template <typename A, typename B> void fCheckEqual(const A& aGot, const B& aExpected, const std::string& aWhat) {
+		if (!(aGot == aExpected)) {
+			std::ostringstream got, expected;
+			got << aGot;
+			expected << aExpected;
+			std::cerr << "FAILED: " << aWhat << ": got '" << got.str() << "' expected '" << expected.str() << "'\n";
+			gFailures++;
+		}
+	}
+	inline void fCheck(bool aCondition, const std::string& aWhat) {
+		if (!aCondition) {
+			std::cerr << "FAILED: " << aWhat << "\n";
+			gFailures++;
+		}
+	}
+	inline int fResult() {
+		if (gFailures != 0) {
+			std::cerr << gFailures << " check(s) failed\n";
+			return 1;
+		}
+		return 0;
+	}
+} // end of namespace testTools
+
+#define TEST_TOOLS_DEFINE_GLOBALS namespace testTools { int gFailures = 0; }
+
+#endif